@@ -0,0 +1,120 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef CLOCK_H
+#define	CLOCK_H
+
+#include "global.h"
+#include "morse.h"
+#include "uart.h"
+
+#define CLOCK_FAST  0
+#define CLOCK_SLOW  1
+
+// Oscillator (8MHz and 2MHz) and Timer 0 prescaler (1:32 and 1:8) settings. 
+// Timer 0 keeps the 4ms period in both modes.
+#define OSC_FAST        0x70
+#define OSC_SLOW        0x50
+#define T0_OPT_FAST     0x04
+#define T0_OPT_SLOW     0x02
+
+// Timer 1 reload values for 10ms system tick in both modes.
+#define TMR1H_FAST      177
+#define TMR1L_FAST      229
+#define TMR1H_SLOW      236
+#define TMR1L_SLOW      125
+
+// System ticks without any activity before switching to the low frequency clock.
+#define CLOCK_IDLE_TICKS    100
+
+// Baud rates selected by the settings: 38400, 57600, 115200, 9600 and 1200
+// (WinKeyer host software).
+#define BAUD_RATE_COUNT     5
+
+volatile unsigned char clockMode = CLOCK_FAST;
+unsigned char clockIdleTicks = 0;
+
+unsigned char baudIndex = 0;
+volatile unsigned char baudRequest = 0;
+
+extern const unsigned short baudFast[BAUD_RATE_COUNT];
+extern const unsigned short baudSlow[BAUD_RATE_COUNT];
+
+// Switch system clock and recompute the timer and baud rate settings. This is 
+// called only from the ISRs.
+static inline void setSystemClock(unsigned char mode)
+{
+    if(mode == CLOCK_FAST)
+    {
+        OSCCON = OSC_FAST;
+        OPTION_REG = T0_OPT_FAST;
+        SPBRGH = baudFast[baudIndex] >> 8;
+        SPBRG = baudFast[baudIndex] & 0x00FF;
+        
+        keyTiming.reloadHigh = TMR1H_FAST;
+        keyTiming.reloadLow = TMR1L_FAST;
+    }
+    else
+    {
+        OSCCON = OSC_SLOW;
+        OPTION_REG = T0_OPT_SLOW;
+        SPBRGH = baudSlow[baudIndex] >> 8;
+        SPBRG = baudSlow[baudIndex] & 0x00FF;
+        
+        keyTiming.reloadHigh = TMR1H_SLOW;
+        keyTiming.reloadLow = TMR1L_SLOW;
+    }
+    
+    clockMode = mode;
+    clockIdleTicks = 0;
+}
+
+// Clock governor, called from Timer 1 ISR on every system tick.
+static inline void updateSystemClock(unsigned char isActive)
+{
+    // Baud rate change is applied after the last byte is sent to the host.
+    if((baudRequest != baudIndex) && TRMT && (txReadPos == txWritePos))
+    {
+        baudIndex = baudRequest;
+        setSystemClock((baudSlow[baudIndex] == 0) ? CLOCK_FAST : clockMode);
+    }
+    
+    if(isActive)
+    {
+        clockIdleTicks = 0;
+        
+        if(clockMode != CLOCK_FAST)
+        {
+            setSystemClock(CLOCK_FAST);
+        }
+    }
+    else if(clockMode == CLOCK_FAST)
+    {
+        // Baud rate is changed only while the receiver and transmitter are idle.
+        if((++clockIdleTicks >= CLOCK_IDLE_TICKS) && RCIDL && TRMT && (baudSlow[baudIndex] != 0))
+        {
+            setSystemClock(CLOCK_SLOW);
+        }
+    }
+}
+
+#endif	/* CLOCK_H */
@@ -0,0 +1,184 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include "diag.h"
+#include "uart.h"
+#include "scheduler.h"
+#include "clock.h"
+#include "morse.h"
+
+#ifdef STACK_DEBUG
+const char * const diagLabel[DIAG_ITEM_COUNT] = {"BOOT", "MISS", "WPM", "OVR", "STACK"};
+#else
+const char * const diagLabel[DIAG_ITEM_COUNT] = {"BOOT", "MISS", "WPM", "OVR"};
+#endif
+
+// Decimal places of the report values, up to 5 digits.
+#define DIAG_DIGITS         5
+
+const unsigned short diagDecimal[DIAG_DIGITS] = {10000, 1000, 100, 10, 1};
+
+// Time elapsed since Timer 1 is started by the initSystem. Timer 1 counts in 
+// 0.5us steps at 8MHz and the first system tick is not served yet.
+unsigned short readBootTime()
+{
+    unsigned char timerHigh, timerLow;
+    
+    // Boot time is longer than the first system tick.
+    if(TMR1IF)
+    {
+        return MAX_SHORT;
+    }
+    
+    // Read the running timer again if the low byte is overflowed in between.
+    do
+    {
+        timerHigh = TMR1H;
+        timerLow = TMR1L;
+    }
+    while(timerHigh != TMR1H);
+    
+    return ((((unsigned short)timerHigh << 8) | timerLow) - (((unsigned short)TMR1H_FAST << 8) | TMR1L_FAST)) >> 1;
+}
+
+// Value of the current report item, read when the item is started.
+void readDiagValue()
+{
+    switch(diagItem)
+    {
+        case DIAG_BOOT_TIME:
+            diagValue = diagBootTime;
+            break;
+        case DIAG_DEADLINE_MISS:
+            diagValue = deadlineMissCount;
+            break;
+        case DIAG_SPEED:
+            diagValue = 5 * (keyTiming.speed + 1);
+            break;
+        case DIAG_RX_OVERRUN:
+            diagValue = rxOverrunCount;
+            break;
+#ifdef STACK_DEBUG
+        case DIAG_STACK_DEPTH:
+            diagValue = stackPeak;
+            break;
+#endif
+    }
+}
+
+// Character of the current report item at diagTextPos, or zero after the end of 
+// the item.
+unsigned char getDiagChar()
+{
+    const char *label = diagLabel[diagItem];
+    unsigned char textPos = diagTextPos;
+    unsigned char digitPos = 0;
+    
+    while(*label != '\0')
+    {
+        if(textPos == 0)
+        {
+            return *label;
+        }
+        
+        textPos--;
+        label++;
+    }
+    
+    if(textPos == 0)
+    {
+        return '=';
+    }
+    
+    textPos--;
+    
+    // Decimal digits of the value without the leading zeros.
+    while((digitPos < (DIAG_DIGITS - 1)) && (diagValue < diagDecimal[digitPos]))
+    {
+        digitPos++;
+    }
+    
+    if(textPos < (DIAG_DIGITS - digitPos))
+    {
+        return ((diagValue / diagDecimal[digitPos + textPos]) % 10) + 48;
+    }
+    
+    textPos -= DIAG_DIGITS - digitPos;
+    
+    // Items are separated by space and the report is terminated with CR LF.
+    if(diagItem < (DIAG_ITEM_COUNT - 1))
+    {
+        return (textPos == 0) ? ' ' : 0;
+    }
+    
+    if(textPos < 2)
+    {
+        return (textPos == 0) ? '\r' : '\n';
+    }
+    
+    return 0;
+}
+
+// Diagnostics report requested by the host. Report is written into the UART 
+// transmit buffer as space permits, so this task never waits for the UART.
+void diagnosticsTask()
+{
+    unsigned char data;
+    
+    if(diagItem == DIAG_IDLE)
+    {
+        // Request waits until the other host replies are completed.
+        if((diagRequest == FALSE) || (claimReply(REPLY_DIAG) == FALSE))
+        {
+            return;
+        }
+        
+        diagRequest = FALSE;
+        diagItem = 0;
+        diagTextPos = 0;
+        readDiagValue();
+    }
+    
+    while(diagItem < DIAG_ITEM_COUNT)
+    {
+        data = getDiagChar();
+        
+        if(data == 0)
+        {
+            diagItem++;
+            diagTextPos = 0;
+            readDiagValue();
+        }
+        else if(sendChar(data) == 0)
+        {
+            diagTextPos++;
+        }
+        else
+        {
+            // Transmit buffer is full, continue in the next period.
+            return;
+        }
+    }
+    
+    diagItem = DIAG_IDLE;
+    replyOwner = REPLY_NONE;
+}
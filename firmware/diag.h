@@ -0,0 +1,63 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef DIAG_H
+#define	DIAG_H
+
+#include "global.h"
+
+// Diagnostics report items.
+#define DIAG_BOOT_TIME      0   // Start of the firmware to interrupts enabled, in microseconds.
+#define DIAG_DEADLINE_MISS  1   // Task deadline misses of the scheduler.
+#define DIAG_SPEED          2   // Keying speed in WPM.
+#define DIAG_RX_OVERRUN     3   // UART receive overruns, bytes are lost in each.
+
+#ifdef STACK_DEBUG
+#define DIAG_STACK_DEPTH    4   // Worst case hardware stack levels in use.
+#define DIAG_ITEM_COUNT     5
+#else
+#define DIAG_ITEM_COUNT     4
+#endif
+#define DIAG_IDLE           0xFF
+
+// Report items are sent as label, '=', value and the separator. Text is made up 
+// character by character from the value of the item being sent.
+unsigned short diagBootTime = 0;
+unsigned short diagValue = 0;
+
+volatile unsigned char diagRequest = FALSE;
+unsigned char diagItem = DIAG_IDLE;
+unsigned char diagTextPos = 0;
+
+#ifdef STACK_DEBUG
+// Deepest call chain of the main code plus the deepest call chain of the ISR. The 
+// PIC16 stack pointer is not readable, so this is updated by the function entry 
+// hooks of the instrumented host build (make STACK_DEBUG=1 in the simulator).
+unsigned char stackPeak = 0;
+#endif
+
+unsigned short readBootTime(void);
+void readDiagValue(void);
+unsigned char getDiagChar(void);
+void diagnosticsTask(void);
+
+#endif	/* DIAG_H */
@@ -50,30 +50,71 @@
 #define MAX_BYTE    0xFF
 
 #define RING_BUFFER_SIZE    64
-#define MORSE_BUFFER_SIZE   6
 
+// RAM arena is placed in a separate bank from the typeahead buffer. Typeahead 
+// buffer extension makes up 128 characters with the ring buffer.
+#define ARENA_QUEUE_SIZE    64
+#define SCROLL_BUFFER_SIZE  17
+#define MESSAGE_BUFFER_SIZE 32
+
+// Main screen text window takes the first 13 columns, and it's shadow line is 
+// kept at the end of the arena, after the typeahead buffer extension.
+#define WINDOW_LENGTH       13
+
+#define ARENA_QUEUE         0
+#define ARENA_MESSAGE       1
+
+// Settings fields. Each field is a byte in the systemConfig array.
 #define OPT_INPUT_MODE      0
-#define OPT_KEYER_TYPE      2
-#define OPT_SPEED           4
-#define OPT_SPEAKER_OUT     6
-#define OPT_LOOP_SEND       8
-#define OPT_TONE_TYPE       10
+#define OPT_KEYER_TYPE      1
+#define OPT_SPEED           2
+#define OPT_SPEAKER_OUT     3
+#define OPT_LOOP_SEND       4
+#define OPT_TONE_TYPE       5
+#define OPT_KEY_FILTER      6
+#define OPT_PTT_TIMING      7
+#define OPT_TONE_FREQ       8
+#define OPT_REC_MODE        9
+#define OPT_BAUD_RATE       10
+
+#define SETTINGS_FIELDS     11
+
+#define TX_ABORT    0x01
+#define TX_PAUSE    0x02
+#define TX_RESEND   0x04
 
 volatile typedef struct 
 {
     unsigned char morseBuffer[RING_BUFFER_SIZE];
     unsigned char writePos;
     unsigned char readPos;
+    unsigned char size;
 } ringBuffer;
 
-volatile typedef struct
+// Mode scoped RAM arena. Main and menu screens use it to extend the typeahead 
+// buffer and memory screens hold the message buffers. Window line is used only 
+// by the main screen.
+typedef union
 {
-    char morseCodeBuffer[MORSE_BUFFER_SIZE];
-    unsigned char bufferPos;
-} morseBuffer;
+    struct
+    {
+        unsigned char queue[ARENA_QUEUE_SIZE];
+        char windowLine[WINDOW_LENGTH];
+    } typeahead;
+    struct
+    {
+        char scrollBuffer[SCROLL_BUFFER_SIZE];
+        unsigned char eepromBuffer[MESSAGE_BUFFER_SIZE];
+    } message;
+} ramArena;
+
+ramArena arena;
+unsigned char arenaOwner = ARENA_QUEUE;
 
-unsigned short systemConfig = 0x00;
+unsigned char systemConfig[SETTINGS_FIELDS];
 unsigned char shadowPortC = 0x00;
 
+volatile unsigned char txControl = 0x00;
+
 #endif	/* GLOBAL_H */
 
@@ -22,36 +22,65 @@
 
 #include "lcd1602.h"
 
+// Send a half (4 bits) of the instruction, the high half first.
 void sendCommand(unsigned char cmd)
 {
     PORTA &= 0x03;
     __delay_us(50);
     PORTA |= cmd << 4;
     PORTA |= 0x08;
-    __delay_ms(4);
+    __delay_us(50);
     PORTA &= 0xF7;
 }
 
+// Run the next step of the display initialization. This is called from the LCD 
+// task and the task period (20ms) is the delay between the reset commands.
 void initLCD()
 {
-    PORTA = 0x00;
-    __delay_ms(5);
-    
-    // Try to reset the HD44780 controller.
-    sendCommand(0x03);
-    __delay_ms(5);
-    sendCommand(0x03);
-    __delay_ms(15);
-    sendCommand(0x03);
-    
-    // Initialize display with default character set font size.
-    sendCommand(0x02);
-    sendCommand(0x02);
-    sendCommand(0x08);
-    sendCommand(0x00);
-    sendCommand(0x0C);
-    sendCommand(0x00);
-    sendCommand(0x06);
+    unsigned char glyph;
+    unsigned char glyphRow;
+    
+    switch(lcdBootStep)
+    {
+        case 0:
+            // Try to reset the HD44780 controller.
+            PORTA = 0x00;
+            sendCommand(0x03);
+            break;
+        case 1:
+            sendCommand(0x03);
+            break;
+        case 2:
+            sendCommand(0x03);
+            
+            // Initialize display with default character set font size.
+            sendCommand(0x02);
+            sendCommand(0x02);
+            sendCommand(0x08);
+            sendCommand(0x00);
+            sendCommand(0x0C);
+            sendCommand(0x00);
+            sendCommand(0x06);
+            break;
+        default:
+            // Load bar meter glyphs into CGRAM. Glyph n is filled with n + 1 rows 
+            // from the bottom.
+            sendCommand(0x04);
+            sendCommand(0x00);
+            
+            for(glyph = 0; glyph < METER_LEVELS; glyph++)
+            {
+                for(glyphRow = 0; glyphRow < 8; glyphRow++)
+                {
+                    printChar((glyphRow >= (7 - glyph)) ? 0x1F : 0x00);
+                }
+            }
+            
+            clearLCD();
+            setCursor(1, 1);
+    }
+    
+    lcdBootStep++;
 }
 
 void clearLCD()
@@ -59,8 +88,15 @@ void clearLCD()
     sendCommand(0x00);
     sendCommand(0x01);
     
+    // Clear command needs 1.52ms to execute, others complete within 37us.
+    __delay_ms(2);
+    
     displayRow = 1;
     displayCol = 1;
+    windowPos = 0;
+    windowWordStart = 0;
+    meterLevel = MAX_BYTE;
+    meterSpeed = MAX_BYTE;
 }
 
 void printChar(char value)
@@ -82,7 +118,7 @@ void printChar(char value)
     PORTA &= 0xF7;
 }
 
-void printStr(char *str) 
+void printStr(const char *str) 
 {
     unsigned char pos;
     for(pos = 0; str[pos]!='\0'; pos++)
@@ -91,23 +127,80 @@ void printStr(char *str)
     }
 }
 
+// Print the shadow line from the first column and blank the rest of the window.
+static void printLine(unsigned char length)
+{
+    unsigned char pos;
+    
+    for(pos = 0; pos < WINDOW_LENGTH; pos++)
+    {
+        printChar((pos < length) ? windowLine[pos] : ' ');
+    }
+}
+
+// Main screen text window. Text is written into the top row and then into the 
+// bottom row, and each full bottom row is rolled up into the top row. Word which 
+// does not fit into the row is moved to the next row.
 void printWindow(char value)
 {
-    if((++displayCol) > MAX_DISPLAY_LENGTH)
+    unsigned char keepLength = 0;
+    unsigned char pos;
+    
+    // Space is not printed at the start of a row.
+    if((value == ' ') && (windowPos == 0))
+    {
+        return;
+    }
+    
+    if(windowPos >= WINDOW_LENGTH)
     {
-        // End of column reached and switch to the next row of the display.
-        displayCol = 1;
-        if((++displayRow) == 3)
+        // Partial word is moved to the next row, unless it fills the whole row.
+        if((value != ' ') && (windowWordStart > 0))
         {
-            // All display rows are filled, lets clear the display.
-            displayRow = 1;
-            clearLCD();
+            keepLength = WINDOW_LENGTH - windowWordStart;
+        }
+        
+        if(displayRow == 2)
+        {
+            // Roll the bottom row up into the top row.
+            setCursor(1, 1);
+            printLine(WINDOW_LENGTH - keepLength);
         }
+        else if(keepLength > 0)
+        {
+            // Remove the moved word from the top row.
+            setCursor(1, windowWordStart + 1);
+            for(pos = 0; pos < keepLength; pos++)
+            {
+                printChar(' ');
+            }
+        }
+        
+        for(pos = 0; pos < keepLength; pos++)
+        {
+            windowLine[pos] = windowLine[windowWordStart + pos];
+        }
+        
+        setCursor(2, 1);
+        printLine(keepLength);
+        setCursor(2, keepLength + 1);
+        
+        windowPos = keepLength;
+        windowWordStart = 0;
         
-        setCursor(displayRow, displayCol);
+        if(value == ' ')
+        {
+            return;
+        }
     }
     
+    windowLine[windowPos++] = value;
     printChar(value);
+    
+    if(value == ' ')
+    {
+        windowWordStart = windowPos;
+    }
 }
 
 void setCursor(unsigned char row, unsigned char col)
@@ -172,3 +265,33 @@ void printScroll(char value)
     // Update display with scroll buffer content.
     printStr(scrollBuffer);
 }
+
+// Main screen meters. Only the changed cells are written, and the cursor is 
+// returned to the text window.
+void updateMeter(unsigned char level, unsigned char speed)
+{
+    unsigned char row = displayRow;
+    
+    if((level == meterLevel) && (speed == meterSpeed))
+    {
+        return;
+    }
+    
+    if(level != meterLevel)
+    {
+        // Empty buffer is shown as a blank cell.
+        setCursor(1, METER_COL);
+        printChar((level == 0) ? ' ' : (level - 1));
+        meterLevel = level;
+    }
+    
+    if(speed != meterSpeed)
+    {
+        setCursor(1, METER_COL + 1);
+        printChar((speed < 10) ? ' ' : ((speed / 10) + 48));
+        printChar((speed % 10) + 48);
+        meterSpeed = speed;
+    }
+    
+    setCursor(row, windowPos + 1);
+}
@@ -27,17 +27,38 @@
 
 #define MAX_DISPLAY_LENGTH 16
 
+// Display controller is initialized in steps, one step per LCD task period.
+#define LCD_BOOT_STEPS  4
+
+// Main screen layout. Text window takes the first 13 columns (WINDOW_LENGTH) of 
+// both rows and the meters are in the last 3 columns of the top row: typeahead 
+// buffer fill (bar glyph) and the keying speed in WPM.
+#define METER_COL       14
+#define METER_LEVELS    8
+
+unsigned char lcdBootStep = 0;
 unsigned char displayRow = 1;
 unsigned char displayCol = 1;
 unsigned char scrollPos = 0;
 
-char scrollBuffer[MAX_DISPLAY_LENGTH + 1];
+// Position in the active row of the main screen text window and the start of the 
+// last word in it. Shadow of the row is in the RAM arena.
+unsigned char windowPos = 0;
+unsigned char windowWordStart = 0;
+
+// Meter values on the display. MAX_BYTE marks a cleared meter.
+unsigned char meterLevel = MAX_BYTE;
+unsigned char meterSpeed = MAX_BYTE;
+
+// Scroll buffer is in the RAM arena while memory screens are active.
+#define scrollBuffer (arena.message.scrollBuffer)
+#define windowLine (arena.typeahead.windowLine)
 
 void clearLCD(void);
 void initLCD(void);
 
 void printChar(char value);
-void printStr(char *str);
+void printStr(const char *str);
 void printWindow(char value);
 void setCursor(unsigned char row, unsigned char col);
 void clearRow(unsigned char row);
@@ -45,5 +66,7 @@ void clearRow(unsigned char row);
 void clearScrollBuffer(void);
 void printScroll(char value);
 
+void updateMeter(unsigned char level, unsigned char speed);
+
 #endif	/* LCD1602_H */
 
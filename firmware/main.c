@@ -27,118 +27,101 @@
 #include "ringbuffer.h"
 #include "morse.h"
 #include "mem_manager.h"
+#include "scheduler.h"
+#include "clock.h"
+#include "diag.h"
+#include "winkey.h"
+#include "trace.h"
+
+// Menu item names and sub menu option lists, all placed in the program memory.
+const char * const inputModeItems[] = {"Host terminal", "Keyer", "Host + Keyer"};
+const char * const keyerTypeItems[] = {"Morse key", "Morse paddle"};
+const char * const speedItems[] = {"5 WPM", "10 WPM", "15 WPM"};
+const char * const speakerItems[] = {"Active", "Mute"};
+const char * const onOffItems[] = {"On", "Off"};
+const char * const keyingTypeItems[] = {"PTT", "Tone", "PTT + Tone"};
+const char * const keyFilterItems[] = {"Off", "Light", "Normal", "Heavy"};
+const char * const pttTimingItems[] = {"Full QSK", "Fast", "Normal", "Slow"};
+const char * const tonePitchItems[] = {"750 Hz", "500 Hz", "600 Hz", "1000 Hz"};
+const char * const recordModeItems[] = {"Text", "Fist"};
+const char * const serialItems[] = {"Continue", "Reset to 001"};
+const char * const baudRateItems[] = {"38400", "57600", "115200", "9600", "1200"};
+
+// System menu: title, options, number of options, settings field and action.
+const menuEntry systemMenu[MENU_ITEM_COUNT] = 
+{
+    {"Input mode", inputModeItems, 3, OPT_INPUT_MODE, 0},
+    {"Keyer type", keyerTypeItems, 2, OPT_KEYER_TYPE, 0},
+    {"Morse speed", speedItems, 3, OPT_SPEED, 0},
+    {"Speaker out", speakerItems, 2, OPT_SPEAKER_OUT, 0},
+    {"Send in loop", onOffItems, 2, OPT_LOOP_SEND, 0},
+    {"Keying type", keyingTypeItems, 3, OPT_TONE_TYPE, 0},
+    {"Key filter", keyFilterItems, 4, OPT_KEY_FILTER, 0},
+    {"PTT timing", pttTimingItems, 4, OPT_PTT_TIMING, 0},
+    {"Tone pitch", tonePitchItems, 4, OPT_TONE_FREQ, 0},
+    {"Record mode", recordModeItems, 2, OPT_REC_MODE, 0},
+    {"Serial number", serialItems, 2, 0, resetSerialAction},
+    {"Baud rate", baudRateItems, BAUD_RATE_COUNT, OPT_BAUD_RATE, 0}
+};
+
+// Run the highest priority task released by the system tick. This is inlined into 
+// the main loop to keep the call depth of the tasks.
+static inline void runNextTask()
+{
+    // Tasks run to completion and must not block.
+    if(taskReady & TASK_KEYING)
+    {
+        taskReady &= ~TASK_KEYING;
+        keyingTask();
+    }
+    else if(taskReady & TASK_INPUT)
+    {
+        taskReady &= ~TASK_INPUT;
+        inputTask();
+    }
+    else if(taskReady & TASK_UART_TX)
+    {
+        taskReady &= ~TASK_UART_TX;
+        diagnosticsTask();
+        traceTask();
+        slotTransferTask();
+        winkeyTask(getBufferCount(&dataBuffer), dataBuffer.size);
+        
+        // WinKeyer host is paused by the status report instead of XOFF.
+        uartTxTask((winkeyOpen == TRUE) ? 0 : getBufferCount(&dataBuffer), dataBuffer.size);
+    }
+    else if(taskReady & TASK_EEPROM)
+    {
+        taskReady &= ~TASK_EEPROM;
+        eepromTask();
+    }
+    else if(taskReady & TASK_LCD)
+    {
+        taskReady &= ~TASK_LCD;
+        displayTask();
+    }
+    else if(taskReady & TASK_UI)
+    {
+        taskReady &= ~TASK_UI;
+        uiTask();
+    }
+}
 
 int main() 
 {
-    //Initialize all peripherals, global variables and data structures.
-    unsigned char currentChar = 0;
     unsigned char isSleep = 0;
     
-    shadowPortC = PORTC;
-    systemConfig = loadSystemSettings();
-    
-    initSystem();
-    updateSystemSettings();
-    
-    initRingBuffer(&dataBuffer);
-    initMorseBuffer(&morseCodeBuffer);
-            
-    __delay_ms(20);
-    
-    // Activate LCD screen and it's the backlight.
-    lastInputStatus = PORTB & PORTB_MASK;
-    clearLCD();
-    setCursor(1, 1);
-    
-    __delay_ms(10);
-    
-    // Enable interrupts to serve user actions.
-    enableInterrupts();
-    
-    // Activate LCD backlight.
-    shadowPortC |= 0x20;
-    PORTC = shadowPortC;
+    startSystem();
     
     while(1)
     {
         // Continue main service loop if sleep flag is cleared.
         while(isSleep == 0)
         {
-            currentInputStatus = PORTB & PORTB_MASK;
-
-            // Rotary encoder button pressed. Open the system menu.
-            if(IS_BUTTON_PRESS(BTN_ROTARY_ENCODER))
-            {
-                PIE1 = 0x00;
-                PIR1 = 0x00;
-                sleepCounter = 0;
-                
-                __delay_ms(50);
-                systemMenuHandler();
-                saveSystemSettings(systemConfig);
-                
-                enableInterrupts();
-                sleepCounter = 0;
-
-                setCursor(1, 1);
-                clearLCD();  
-            }
-
-            // Check for PTT override key press.
-            if(IS_BUTTON_PRESS(BTN_PTT_OVERRIDE))
-            {
-                pttOverride = ~pttOverride;
-                shadowPortC &= 0xF7;
-
-                if(pttOverride == TRUE)
-                {
-                    shadowPortC |= 0x08; 
-                }
-
-                PORTC = shadowPortC;
-                sleepCounter = 0;
-                __delay_ms(50);
-            }
-
-            // Check for memory keying button press.
-            if(IS_BUTTON_PRESS(BTN_MEM_MANAGER))
-            {
-                __delay_ms(150);
-                sleepCounter = 0;
-                
-                memoryKeyHandler();
-                sleepCounter = 0;
-                
-                setCursor(1, 1);
-                clearLCD();
-            }
-
-            if(operatingMode == 0x0000)
-            {
-                // System is in USB mode.
-                if(popFromBuffer(&dataBuffer, &currentChar) == 0)
-                {
-                    printWindow(currentChar);
-                    encodeCharacter(currentChar);
-                    
-                    sleepCounter = 0;
-                }
-            }
-            else 
-            {
-                // System is in KEY mode.
-                generateMorseOutput();
-
-                if(popFromBuffer(&dataBuffer, &currentChar) == 0)
-                {
-                    printWindow(currentChar);
-                    
-                    sleepCounter = 0;
-                }
-            }
+            runNextTask();
 
-            // Check for system idle state.
-            if(sleepCounter > SLEEP_TIME_LIMIT)
+            // Check for system idle state. Sleep is allowed only in the main screen.
+            if((sleepCounter > SLEEP_TIME_LIMIT) && (uiScreen == SCREEN_MAIN) && (txPattern == 0) && (pttState == PTT_IDLE))
             {
                 sleepCounter = 0;
                 
@@ -148,11 +131,12 @@ int main()
                 PIE1 = 0x00;
                 PIR1 = 0x00;
                 
+                CCP1CON = 0x20;
+                envelopeStep = 0;
+                
                 isSleep = TRUE;
                 break;
             }
-
-            lastInputStatus = currentInputStatus;
         }
         
         // Entering sleep mode state...
@@ -170,11 +154,12 @@ int main()
                 shadowPortC |= 0x20;
                 PORTC = shadowPortC;
                 
-                enableInterrupts();
+                // Button which wakes the system is debounced by the Timer 0 ISR and 
+                // does not raise a press event.
+                resetButtonState();
+                buttonEvents = 0;
                 
-                __delay_ms(150);
-                currentInputStatus = PORTB & PORTB_MASK;
-                lastInputStatus = currentInputStatus;
+                enableInterrupts();
                 
                 break;
             }
@@ -183,790 +168,1676 @@ int main()
     }
 }
 
-void generateMorseOutput()
+void keyingTask()
 {
-    if(keyerTypeId == 0x00)
+    unsigned char currentChar;
+    
+    // Element captured by the Timer 1 ISR in fist recording session.
+    if(fistMarkTicks != 0)
     {
-        // Handle generic morse keyer.
-        if((PORTB & keyerPortMask) == keyerPortMask)
-        {
-            disablePulse();
-        }
-        else 
-        {
-            enablePulse();
-        }
+        storeFistElement(fistMarkTicks, fistSpaceTicks);
+        fistMarkTicks = 0;
     }
-    else 
+    
+    // Wait until the transmit engine completes the active character.
+    if(txPattern != 0)
     {
-        // Handle paddle type morse keyer and emit output based on active 
-        // paddle.
-        if((PORTB & keyerPortMask) != keyerPortMask)
-        {
-            if((PORTB & 0x10) == 0x00)
-            {
-                // Handle dah (dash) with 3 delay units.
-                enablePulse();
-                unitDelay();
-                unitDelay();
-                unitDelay();
-                disablePulse();
-            }
-            else
-            {
-                // Handle dit (dot) with single delay unit.)
-                enablePulse();
-                unitDelay();
-                disablePulse();
-            }
-        }
+        return;
     }
-}
-
-void isrTimer0()
-{
-    // Timer 0 - 250Hz (40ms) interrupt handler (reserved for low priority routines).
-    if(T0IF)
+    
+    // Settings changed by the host are saved into the E2PROM.
+    if(hostSaveRequest == TRUE)
     {
-        // Check rotary encoder status.
-        if((PORTB & 0x03) != 0x03)
-        {
-            if((!RB0) && (lastEncoderVal))
-            {
-                if(RB1)
-                {
-                    encoderPosition++;
-                }
-                else 
-                {
-                    encoderPosition = (encoderPosition > 0) ? (encoderPosition - 1) : ROTARY_ENCODER_END;
-                }
-            }
-        }
+        hostSaveRequest = FALSE;
+        saveSystemSettings(systemConfig);
+    }
+    
+    // Speed change issued by the host is applied between characters.
+    if(keySpeed != keyTiming.speed)
+    {
+        updateTimingProfile();
+    }
+    
+    // Serve abort request issued by the host.
+    if(txControl & TX_ABORT)
+    {
+        flushHostBuffer();
         
-        // Increase sleep counter to detect system idle.
-        if(sleepCounter < MAX_SHORT)
+        if(playState != PLAY_IDLE)
         {
-            sleepCounter++;
+            cancelPlayback();
         }
         
-        // Restore timer 0 with 250Hz timing cycles.
-        lastEncoderVal = RB0; 
-        TMR0 = 6;
-        T0IF = 0;
+        return;
     }
-}
-
-void isrTimer1()
-{
-    static unsigned char holdCounter = 0;
-    static unsigned char lastMorseCode = 0;
-    static unsigned char flagChar = TRUE;
-    static unsigned char flagWord = TRUE;
-    static unsigned char releaseCounter = MAX_BYTE;
-    static unsigned char unitDelayRef = 0;
     
-    unsigned char tempDecodeChar;
+    // LCD task is not yet consumed the last character.
+    if(displayChar != 0)
+    {
+        return;
+    }
     
-    // Timer 1 - 100Hz (10ms) interrupt handler for time based events.
-    if(TMR1IF)
+    // Character decoded from the manual key in dual input mode is already sent.
+    if(decodedChar != 0)
+    {
+        releaseCharacter(decodedChar);
+        decodedChar = 0;
+        return;
+    }
+    
+    // Host text and memory playback are held while the operator breaks in.
+    if(breakInTicks > 0)
+    {
+        return;
+    }
+    
+    if(txControl & TX_RESEND)
+    {
+        // Send the character which is cut by the break-in again.
+        txControl &= ~TX_RESEND;
+        encodeCharacter(txCharacter);
+        return;
+    }
+    
+    if(playState == PLAY_SENDING)
     {
-        if(operatingMode == 0x0001)
+        // Digits of the expanded serial number are sent before the next byte of the slot.
+        if(macroText[macroPos] != 0)
         {
-            // Calculate actual delay for delay unit based on selected WPM.
-            switch(keySpeed)
+            currentChar = macroText[macroPos];
+            macroPos++;
+            
+            encodeCharacter(currentChar);
+            displayChar = currentChar;
+            sleepCounter = 0;
+            return;
+        }
+        
+        // Memory playback is served before the typeahead buffer.
+        currentChar = eeprom_read(playAddr);
+        
+        if((currentChar == END_OF_MESSAGE) || (playAddr >= (MEM_MSG_BASE + ((memSlot + 1) * (MEM_MSG_SIZE + 1)))))
+        {
+            // End of message transmission and now check looping flag.
+            if(loopMessage == 0x00)
             {
-                case 1:
-                    unitDelayRef = 12;
-                    break;
-                case 2:
-                    unitDelayRef = 8;
-                    break;
-                default:
-                    unitDelayRef = 24;
+                playState = PLAY_LOOP_WAIT;
+                loopWaitCount = 0;
+                lcdRedraw = TRUE;
             }
-
-            if((PORTB & keyerPortMask) == keyerPortMask)
+            else 
+            {
+                playState = PLAY_IDLE;
+            }
+            
+            playFist = FALSE;
+            
+            // Inline speed change is valid until the end of the message.
+            keySpeed = playSpeed;
+            
+            if(serialUsed == TRUE)
             {
-                // KEY UP state.
+                // Next contact gets the next serial number.
+                serialUsed = FALSE;
                 
-                // Count key release (idle) time.
-                if(releaseCounter < MAX_BYTE)
-                {
-                    releaseCounter++;
-                }
-
-                if((releaseCounter > unitDelayRef) && (lastMorseCode != CODE_EMPTY))
-                {
-                    // End of morse signal reached.
-                    updateMorseBuffer(&morseCodeBuffer, lastMorseCode);
-                    lastMorseCode = CODE_EMPTY;
-                }
-
-                if((releaseCounter > unitDelayRef * 4) && (flagChar == FALSE))
-                {
-                    // End of character reached.
-                    tempDecodeChar = decodeCharacter(&morseCodeBuffer);
-                    if(tempDecodeChar > 0)
-                    {
-                        pushToBuffer(&dataBuffer, tempDecodeChar);
-                    }
-
-                    initMorseBufferISR(&morseCodeBuffer);
-                    flagChar = TRUE;
-                }
-
-                if((releaseCounter > unitDelayRef * 10) && (flagWord == FALSE))
-                {
-                    // End of word reached and pushed SPACE into the buffer.
-                    pushToBuffer(&dataBuffer, 32);
-                    flagWord = TRUE;
-                }
-
-                // Detect last key down time and decode morse symbol from that.
-                if(holdCounter > 0)
+                if(contestSerial < SERIAL_MAX)
                 {
-                    if(keyerTypeId == 0x0000)
-                    {
-                        // Generic morse code key handler to determine keyed symbol.
-                        lastMorseCode = (holdCounter >= unitDelayRef * 2) ? CODE_DASH : CODE_DOT;
-                    }
-
-                    holdCounter = 0;
+                    contestSerial++;
+                    saveContestSerial();
                 }
             }
-            else 
+            
+            return;
+        }
+        
+        if(currentChar == FIST_MARKER)
+        {
+            // Slot holds a fist recording.
+            playFist = TRUE;
+        }
+        else if(playFist == TRUE)
+        {
+            playFistElement(currentChar);
+        }
+        else if(currentChar == MACRO_CHAIN)
+        {
+            // Continue with the slot given by the next digit.
+            currentChar = eeprom_read(playAddr + 1);
+            
+            if((currentChar >= '1') && (currentChar < ('1' + MEM_SLOT_COUNT)))
             {
-                // KEY DOWN state.   
-                if(holdCounter < MAX_BYTE)
-                {
-                    holdCounter++;
-                }
-
-                if(keyerTypeId == 0x0000)
-                {
-                    // For normal key, wait until user hold the key to determine the symbol.
-                    lastMorseCode = CODE_EMPTY;
-                }
-                else 
-                {
-                    // Detect which paddle is keyed.
-                    lastMorseCode = ((PORTB & 0x10) == 0x00) ? CODE_DASH : CODE_DOT;
-                }
-
-                releaseCounter = 0;
-                flagChar = FALSE;
-                flagWord = FALSE;
+                memSlot = currentChar - '1';
+                playAddr = MEM_MSG_BASE + (memSlot * (MEM_MSG_SIZE + 1));
+                return;
+            }
+            
+            // Skip the invalid slot number. Marker at the end of the message is 
+            // ignored and the end of the message is kept.
+            if(currentChar != END_OF_MESSAGE)
+            {
+                playAddr++;
             }
         }
+        else if(expandMacro(currentChar) == FALSE)
+        {
+            encodeCharacter(currentChar);
+            displayChar = currentChar;
+        }
         
-        // Restore timer 1 with 100Hz timing cycles.
-        TMR1H = 177;
-        TMR1L = 229;
-        TMR1IF = 0;
+        playAddr++;
+        sleepCounter = 0;
+        return;
     }
-}
-
-void isrUART()
-{
-    // UART data receive interrupt.
-    unsigned char tempData;
     
-    if(RCIF)
+    if(playState == PLAY_LOOP_WAIT)
     {
-        if(operatingMode == 0x0000)
+        // Lets keep 21 units of spacing between each message and update the 
+        // progress indicator in every 3 units.
+        if(loopWaitCount < 7)
         {
-            tempData = readChar();
-            // Limit characters to A..Z, a..z, 0..9 and SPACE.
-            if(((tempData > 47) && (tempData < 58)) || ((tempData > 64) && (tempData < 91)) || ((tempData > 96) && (tempData < 123)) || (tempData == 32))
-            {
-                pushToBuffer(&dataBuffer, tempData);
-            }
+            loopWaitCount++;
+            transmitGap(3);
+            displayChar = 0xFF;
         }
-        else 
+        else
         {
-            // In keying mode ignore data received from the UART.
-            RCREG;
+            playAddr = MEM_MSG_BASE + (memSlot * (MEM_MSG_SIZE + 1));
+            playState = PLAY_SENDING;
+            lcdRedraw = TRUE;
         }
+        
+        sleepCounter = 0;
+        return;
     }
-}
-
-void __interrupt() systemISR()
-{
-    // TODO: To handle stack-overflow in some CPUs, convert isrTimer0, isrTimer1 and isrUART to inline.   
-
-    // Timer 0 ISR, reserved for low priority tasks such as monitoring UI ports.
-    isrTimer0();
-    
-    // Timer 1 SIR, reserved for morse keying detection.
-    isrTimer1();
-    
-    // UART ISR, used to capture data received from USB endpoint.
-    isrUART();
-}
-
-unsigned char systemSubMenuHandler(unsigned char selection, char *menuName, char **menuItems, unsigned char menuItemCount)
-{
-    signed char lastEncoderPosition = ROTARY_ENCODER_END;
     
-    // Display heading of the sub menu.
-    clearLCD();
-    setCursor(1, 1);
-    printStr(menuName);
+    // Recording session holds the typeahead buffer after the memory slot is full.
+    if((uiScreen == SCREEN_RECORD) && (recCount == 0) && (fistRecording == FALSE))
+    {
+        return;
+    }
     
-    // Restore last user selection in menu system.
-    encoderPosition = selection;
-    lastInputStatus = PORTB & PORTB_MASK;
+    // Hold the typeahead buffer while host keeps the transmission paused.
+    if((operatingMode != MODE_KEYER) && (txControl & TX_PAUSE))
+    {
+        return;
+    }
     
-    while(1)
+    if(popFromBuffer(&dataBuffer, &currentChar) == 0)
     {
-        currentInputStatus = PORTB & PORTB_MASK;
-        
-        if(lastEncoderPosition != encoderPosition)
+        // Buffered speed change of the WinKeyer host.
+        if(currentChar >= TOKEN_SPEED)
         {
-            clearRow(2);
-            lastEncoderPosition = encoderPosition;
-            
-            // Handle end of rotary encoder limit.
-            if(encoderPosition == ROTARY_ENCODER_END)
-            {
-                encoderPosition = menuItemCount - 1;
-            }
-            
-            // Handle last element of the selection list.
-            if(encoderPosition == menuItemCount)
-            {
-                encoderPosition = 0;
-            }
-            
-            printStr(menuItems[encoderPosition]);
+            keySpeed = currentChar - TOKEN_SPEED;
+            systemConfig[OPT_SPEED] = keySpeed;
+            return;
         }
         
-        // Check for user confirmation action.
-        if(IS_BUTTON_PRESS(BTN_ROTARY_ENCODER))
+        // In USB and dual modes buffer holds the host text. In KEY mode it holds 
+        // the decoded characters.
+        if(operatingMode != MODE_KEYER)
         {
-            return encoderPosition;
+            encodeCharacter(currentChar);
         }
         
-        lastInputStatus = currentInputStatus;
+        releaseCharacter(currentChar);
     }
 }
 
-void updateSystemSettings()
+void releaseCharacter(unsigned char outChar)
 {
-    // Update global variables based on settings value.
-    operatingMode = systemConfig & 0x0003;
-    keyerTypeId = systemConfig & 0x000C;
-    keySpeed = (systemConfig >> OPT_SPEED) & 0x03;
-    keyerPortMask = ((keyerTypeId == 0x0000) ? 0x08: 0x18);
-    toneType = (systemConfig >> OPT_TONE_TYPE) & 0x03;
-    loopMessage = (systemConfig >> OPT_LOOP_SEND) & 0x03;
-    
-    // Update audio amplifier mute state.    
-    shadowPortC &= 0xEF;
+    // Record user inputs into temporary memory buffer. Characters decoded in dual 
+    // input mode are not held by the keying task, and are dropped once the memory 
+    // slot is full.
+    if((uiScreen == SCREEN_RECORD) && (fistRecording == FALSE) && (recCount > 0))
+    {
+        eepromBuffer[recPos] = outChar;
+        recPos++;
+        recCount--;
+    }
     
-    if((systemConfig & 0x00C0) != 0x0000)
+    // Echo released character to the host. Echo is dropped while a host command 
+    // reply owns the transmit buffer.
+    if(replyOwner == REPLY_NONE)
     {
-        shadowPortC |= 0x10;
+        sendChar(outChar);
     }
     
-    PORTC = shadowPortC;
+    displayChar = outChar;
+    sleepCounter = 0;
 }
 
-void memoryKeyHandler()
+void storeFistElement(unsigned char markTicks, unsigned char spaceTicks)
 {
-    signed char lastEncoderPosition = ROTARY_ENCODER_END;
-    unsigned char memAddr = MEM_MSG_BASE;
-    unsigned char memData = 0;
-    unsigned char memPos = 0;
-    unsigned char buttonHoldCounter = 0;
-    unsigned char currentChar;
-    unsigned char charCount = MEM_MSG_SIZE;
-    unsigned char waitTimeCount = 0;
-    unsigned char userCancel = 0;
-
-    // Initiate a memory manager.
-    clearLCD();
-    setCursor(1, 1);
-    printStr("Memory slot");
+    unsigned char markCode;
+    unsigned char spaceCode;
     
-    encoderPosition = 0;
-    lastInputStatus = PORTB & PORTB_MASK;
+    if(recCount == 0)
+    {
+        return;
+    }
     
-    while(1)
+    // Round mark and space lengths to the nearest quarter delay unit.
+    markCode = (markTicks + (keyTiming.quantumTicks >> 1)) / keyTiming.quantumTicks;
+    spaceCode = (spaceTicks + (keyTiming.quantumTicks >> 1)) / keyTiming.quantumTicks;
+    
+    if(markCode == 0)
     {
-        currentInputStatus = PORTB & PORTB_MASK;
-        
-        // Check for PTT override key press.
-        if(IS_BUTTON_PRESS(BTN_PTT_OVERRIDE))
-        {
-            pttOverride = ~pttOverride;
-            shadowPortC &= 0xF7;
-            
-            if(pttOverride == TRUE)
-            {
-                shadowPortC |= 0x08; 
-            }
-            
-            PORTC = shadowPortC;
-            __delay_ms(50);
-        }
-        
-        // Rotary encoder button is pressed to play the selected slot.
-        if(IS_BUTTON_PRESS(BTN_ROTARY_ENCODER))
-        {
-            __delay_ms(50);
-            
-            // Play routine is built into this function to save stack levels.
+        markCode = 1;
+    }
+    else if(markCode > FIST_MAX_MARK)
+    {
+        markCode = FIST_MAX_MARK;
+    }
+    
+    if(spaceCode > FIST_WORD_SPACE)
+    {
+        spaceCode = FIST_WORD_SPACE;
+    }
+    
+    eepromBuffer[recPos] = (markCode << 4) | spaceCode;
+    recPos++;
+    recCount--;
+}
+
+void playFistElement(unsigned char fistCode)
+{
+    unsigned char markCode = fistCode >> 4;
+    unsigned char spaceCode = fistCode & 0x0F;
+    
+    if(spaceCode == FIST_WORD_SPACE)
+    {
+        spaceCode = FIST_WORD_QUANTA;
+    }
+    
+    transmitElement(markCode * keyTiming.quantumTicks, spaceCode * keyTiming.quantumTicks);
+    
+    // Show dit or dah of the replayed element.
+    displayChar = (markCode >= 8) ? '-' : '.';
+}
+
+unsigned char expandMacro(unsigned char token)
+{
+    unsigned short serial;
+    
+    switch(token)
+    {
+        case MACRO_SERIAL:
+            // Serial number is sent with at least 3 digits (leading zeros).
+            serial = contestSerial;
+            macroPos = 4;
             
-            // Get a first byte from the selected memory page.
-            memAddr = MEM_MSG_BASE + (encoderPosition * (MEM_MSG_SIZE + 1));
-            currentChar = eeprom_read(memAddr);
+            do
+            {
+                macroPos--;
+                macroText[macroPos] = (serial % 10) + '0';
+                serial /= 10;
+            }
+            while((serial > 0) || (macroPos > 1));
             
-            // Check for empty slot.
-            if(currentChar != END_OF_MESSAGE)
+            serialUsed = TRUE;
+            return TRUE;
+        case MACRO_FASTER:
+            if(keySpeed < 2)
             {
-                clearRow(2);
-                clearScrollBuffer();
-                
-                charCount = 0;
-                lastInputStatus = PORTB & PORTB_MASK;
-                userCancel = 0;
+                keySpeed++;
+            }
+            return TRUE;
+        case MACRO_SLOWER:
+            if(keySpeed > 0)
+            {
+                keySpeed--;
+            }
+            return TRUE;
+        case MACRO_PAUSE:
+            transmitDelay(MACRO_PAUSE_TICKS);
+            return TRUE;
+    }
+    
+    return FALSE;
+}
+
+void inputTask()
+{
+    unsigned char eventCode;
+    
+    // Translate debounced button events into the UI actions.
+    while(buttonEventRead != buttonEventWrite)
+    {
+        eventCode = buttonEventQueue[buttonEventRead];
+        buttonEventRead = (buttonEventRead + 1) & (BUTTON_EVENT_SIZE - 1);
+        sleepCounter = 0;
+        
+        switch(eventCode & BTN_EVT_TYPE_MASK)
+        {
+            case BTN_EVT_PRESS:
+                // PTT override toggles as soon as the button is pressed.
+                if(eventCode & BTN_PTT_OVERRIDE)
+                {
+                    buttonEvents |= EVT_PTT_PRESS;
+                }
+                break;
                 
-                // Message looping cycle. This loop iterates only if LOOPING 
-                // is enabled in system settings. 
-                while(userCancel == 0)
+            case BTN_EVT_RELEASE:
+                // Release after the long press is not a button click.
+                if((eventCode & buttonLongPressed) == 0x00)
                 {
-                    while(charCount < MEM_MSG_SIZE + 1)
+                    if(eventCode & BTN_ROTARY_ENCODER)
                     {
-                        currentInputStatus = PORTB & PORTB_MASK;
-
-                        // Wait for stop action (cancel) from user.
-                        if((currentInputStatus & BTN_MEM_MANAGER) == 0x00)
-                        {
-                            clearRow(2);
-                            printStr("CANCEL");
-
-                            while((PORTB & BTN_MEM_MANAGER) == 0x00)
-                            {
-                                __delay_ms(10);
-                            }
-
-                            currentInputStatus = PORTB & PORTB_MASK;
-                            lastInputStatus = currentInputStatus;
-                            userCancel = TRUE;
-                            
-                            __delay_ms(150);
-                            break;
-                        }
+                        buttonEvents |= EVT_ENCODER_PRESS;
+                    }
+                    
+                    if(eventCode & BTN_MEM_MANAGER)
+                    {
+                        buttonEvents |= EVT_MEM_PRESS;
+                    }
+                }
+                
+                buttonLongPressed &= ~(eventCode & BUTTON_MASK);
+                break;
+                
+            case BTN_EVT_LONG_PRESS:
+                buttonLongPressed |= (eventCode & BUTTON_MASK);
+                
+                // MEM button hold initiates the recording session.
+                if(eventCode & BTN_MEM_MANAGER)
+                {
+                    buttonEvents |= EVT_MEM_HOLD;
+                }
+                
+                if(eventCode & BTN_ROTARY_ENCODER)
+                {
+                    buttonEvents |= EVT_ENCODER_REPEAT;
+                }
+                break;
+                
+            case BTN_EVT_REPEAT:
+                // Rotary encoder button held down steps the sub menu options. Other 
+                // screens ignore the repeat.
+                if(eventCode & BTN_ROTARY_ENCODER)
+                {
+                    buttonEvents |= EVT_ENCODER_REPEAT;
+                }
+                break;
+        }
+    }
+}
 
-                        // Check for end of message mark to stop the playback.
-                        if(currentChar == END_OF_MESSAGE)
-                        {
-                           break; 
-                        }
+void uiTask()
+{
+    unsigned char events = buttonEvents;
+    
+    buttonEvents = 0;
+    
+    // PTT override key is served in all the screens.
+    if(events & EVT_PTT_PRESS)
+    {
+        pttOverride = ~pttOverride;
 
-                        // Print current character and release morse code.
-                        printScroll(currentChar);
-                        encodeCharacter(currentChar);
+        if(pttOverride == TRUE)
+        {
+            shadowPortC |= 0x08; 
+        }
+        else if(pttState == PTT_IDLE)
+        {
+            // Transmission in progress releases PTT through the sequencer.
+            shadowPortC &= 0xF7;
+        }
 
-                        // Reading next character from the memory slot.
-                        currentChar = eeprom_read(++memAddr);
+        PORTC = shadowPortC;
+    }
+    
+    switch(uiScreen)
+    {
+        case SCREEN_MAIN:
+            // RAM arena is returned to the typeahead buffer once it's content allows.
+            // Memory slot transfer and E2PROM writes hold the message buffer.
+            if((arenaOwner != ARENA_QUEUE) && (slotState == SLOT_IDLE) && (isMemoryBusy() == FALSE))
+            {
+                claimArena(ARENA_QUEUE);
+            }
+            
+            // Memory screens are opened only after the RAM arena is released by the 
+            // typeahead buffer.
+            if(events & EVT_ENCODER_PRESS)
+            {
+                // Rotary encoder button pressed. Open the system menu.
+                encoderPosition = 0;
+                lastEncoderPosition = 0;
+                uiScreen = SCREEN_MENU;
+                lcdRedraw = TRUE;
+            }
+            else if((events & (EVT_MEM_PRESS | EVT_MEM_HOLD)) && (slotState == SLOT_IDLE) && claimArena(ARENA_MESSAGE))
+            {
+                // Open the memory manager.
+                encoderPosition = 0;
+                lastEncoderPosition = 0;
+                uiScreen = SCREEN_MEMORY;
+                lcdRedraw = TRUE;
+            }
+            break;
+            
+        case SCREEN_MENU:
+            // Handle both ends of the menu item list.
+            if(encoderPosition == ROTARY_ENCODER_END)
+            {
+                encoderPosition = MENU_ITEM_EXIT;
+            }
+            else if(encoderPosition > MENU_ITEM_EXIT)
+            {
+                encoderPosition = 0;
+            }
+            
+            if(events & EVT_ENCODER_PRESS)
+            {
+                if(encoderPosition == MENU_ITEM_EXIT)
+                {
+                    // Exit from menu system.
+                    saveSystemSettings(systemConfig);
+                    uiScreen = SCREEN_MAIN;
+                }
+                else
+                {
+                    // Open selected sub menu item with the last user selection.
+                    menuPos = encoderPosition;
+                    
+                    // Action sub menus (without settings field) start from the first option.
+                    encoderPosition = (systemMenu[menuPos].action != 0) ? 0 : systemConfig[systemMenu[menuPos].position];
+                    uiScreen = SCREEN_SUBMENU;
+                }
+                
+                lastEncoderPosition = encoderPosition;
+                lcdRedraw = TRUE;
+            }
+            break;
+            
+        case SCREEN_SUBMENU:
+            // Step to the next option while the rotary encoder button is held down. 
+            // Selection is applied by the next button press.
+            if(events & EVT_ENCODER_REPEAT)
+            {
+                encoderPosition++;
+            }
+            
+            // Handle end of rotary encoder limit and last element of the selection list.
+            if(encoderPosition == ROTARY_ENCODER_END)
+            {
+                encoderPosition = systemMenu[menuPos].itemCount - 1;
+            }
+            else if(encoderPosition >= systemMenu[menuPos].itemCount)
+            {
+                encoderPosition = 0;
+            }
+            
+            if(events & EVT_ENCODER_PRESS)
+            {
+                if(systemMenu[menuPos].action != 0)
+                {
+                    systemMenu[menuPos].action(encoderPosition);
+                }
+                else
+                {
+                    // Update settings field of the sub menu with user selected option.
+                    systemConfig[systemMenu[menuPos].position] = encoderPosition;
 
-                        lastInputStatus = currentInputStatus;
-                    }
+                    updateSystemSettings();
+                }
+                
+                // Return to main menu from sub menu item.
+                encoderPosition = menuPos;
+                lastEncoderPosition = encoderPosition;
+                uiScreen = SCREEN_MENU;
+                lcdRedraw = TRUE;
+            }
+            break;
+            
+        case SCREEN_MEMORY:
+            if(encoderPosition == ROTARY_ENCODER_END)
+            {
+                encoderPosition = MEM_SLOT_COUNT - 1;
+            }
+            else if(encoderPosition >= MEM_SLOT_COUNT)
+            {
+                encoderPosition = 0;
+            }
+            
+            if(events & EVT_ENCODER_PRESS)
+            {
+                // Rotary encoder button is pressed to play the selected slot.
+                memSlot = encoderPosition;
+                playAddr = MEM_MSG_BASE + (memSlot * (MEM_MSG_SIZE + 1));
+                
+                // Check for empty slot.
+                if(eeprom_read(playAddr) != END_OF_MESSAGE)
+                {
+                    playFist = FALSE;
+                    playSpeed = keySpeed;
+                    serialUsed = FALSE;
+                    macroPos = 4;
+                    playState = PLAY_SENDING;
+                    uiScreen = SCREEN_PLAYBACK;
+                    lcdRedraw = TRUE;
+                }
+            }
+            else if(events & EVT_MEM_PRESS)
+            {
+                // Toggle MEM button to close the memory manager.
+                uiScreen = SCREEN_MAIN;
+                lcdRedraw = TRUE;
+            }
+            else if(events & EVT_MEM_HOLD)
+            {
+                // Start recording session into the selected slot.
+                flushMemoryJob();
+                
+                memSlot = encoderPosition;
+                recPos = 0;
+                recCount = MEM_MSG_SIZE;
+                
+                // Fist recording captures the straight key timing.
+                if((recordMode != 0) && (operatingMode != MODE_HOST) && (keyerTypeId == 0x0000))
+                {
+                    eepromBuffer[0] = FIST_MARKER;
+                    recPos = 1;
+                    recCount = MEM_MSG_SIZE - 1;
+                    fistHold = 0;
+                    fistMarkTicks = 0;
+                    fistRecording = TRUE;
+                }
+                
+                uiScreen = SCREEN_RECORD;
+                lcdRedraw = TRUE;
+            }
+            break;
+            
+        case SCREEN_PLAYBACK:
+            if((events & EVT_MEM_PRESS) && (playState != PLAY_CANCEL))
+            {
+                // Stop action (cancel) from user.
+                cancelPlayback();
+            }
+            else if(playState == PLAY_CANCEL)
+            {
+                // Keep cancel notice in the display for few UI cycles.
+                if((uiTimeout == 0) || ((--uiTimeout) == 0))
+                {
+                    playState = PLAY_IDLE;
+                }
+            }
+            
+            if(playState == PLAY_IDLE)
+            {
+                // End of the message or playback is canceled.
+                encoderPosition = memSlot;
+                lastEncoderPosition = encoderPosition;
+                uiScreen = SCREEN_MEMORY;
+                lcdRedraw = TRUE;
+            }
+            break;
+            
+        case SCREEN_RECORD:
+            if(events & EVT_MEM_PRESS)
+            {
+                // Cancel the recording session.
+                fistRecording = FALSE;
+                uiScreen = SCREEN_MEMORY;
+                lcdRedraw = TRUE;
+            }
+            else if(events & EVT_ENCODER_PRESS)
+            {
+                // Save captured message to the memory.
+                if(fistRecording == TRUE)
+                {
+                    // Close the last element with a word gap.
+                    fistRecording = FALSE;
                     
-                    // End of message transmission and now check looping flag.
-                    if(loopMessage == 0x00)
+                    if(fistHold > 0)
+                    {
+                        storeFistElement(fistHold, MAX_BYTE);
+                    }
+                }
+                
+                eepromBuffer[recPos] = END_OF_MESSAGE;
+                saveMsgBuffer(eepromBuffer, memSlot);
+                
+                uiScreen = SCREEN_MEMORY;
+                lcdRedraw = TRUE;
+            }
+            break;
+    }
+    
+    // Update LCD if rotary encoder position is changed in selection screens.
+    if((uiScreen <= SCREEN_MEMORY) && (uiScreen != SCREEN_MAIN) && (lastEncoderPosition != encoderPosition))
+    {
+        lastEncoderPosition = encoderPosition;
+        lcdRedraw = TRUE;
+    }
+}
+
+void displayTask()
+{
+    unsigned char memAddr;
+    unsigned char memData;
+    unsigned char memPos;
+    
+    // Characters and screen updates are held until the display is initialized.
+    if(lcdBootStep < LCD_BOOT_STEPS)
+    {
+        initLCD();
+        return;
+    }
+    
+    if(lcdRedraw == TRUE)
+    {
+        // Memory preview is postponed until the E2PROM write is completed.
+        if((uiScreen == SCREEN_MEMORY) && isMemoryBusy())
+        {
+            return;
+        }
+        
+        lcdRedraw = FALSE;
+        clearLCD();
+        setCursor(1, 1);
+        
+        switch(uiScreen)
+        {
+            case SCREEN_MENU:
+                printStr("System settings");
+                setCursor(2, 1);
+                printStr((lastEncoderPosition < MENU_ITEM_COUNT) ? systemMenu[lastEncoderPosition].title : "Exit");
+                break;
+                
+            case SCREEN_SUBMENU:
+                printStr(systemMenu[menuPos].title);
+                setCursor(2, 1);
+                printStr(systemMenu[menuPos].items[lastEncoderPosition]);
+                break;
+                
+            case SCREEN_MEMORY:
+            case SCREEN_PLAYBACK:
+                printStr("Memory slot");
+                setCursor(1, 13);
+                printChar(((uiScreen == SCREEN_MEMORY) ? lastEncoderPosition : memSlot) + 49);
+                setCursor(2, 1);
+                
+                if(uiScreen == SCREEN_PLAYBACK)
+                {
+                    // Playback progress notices.
+                    if(playState == PLAY_LOOP_WAIT)
                     {
-                        // Read first character of the message from the memory slot.
-                        memAddr = MEM_MSG_BASE + (encoderPosition * (MEM_MSG_SIZE + 1));
-                        currentChar = eeprom_read(memAddr);
-                        
-                        clearRow(2);
                         printStr("LOOPING  ");
+                    }
+                    else if(playState == PLAY_CANCEL)
+                    {
+                        printStr("CANCEL");
+                    }
+                    
+                    clearScrollBuffer();
+                    break;
+                }
                 
-                        charCount = 0;
-                        waitTimeCount = 0;
-                        
-                        // Break looping if user issues cancel. 
-                        if(userCancel == TRUE)
+                // Try to preview content of the slot.
+                memAddr = MEM_MSG_BASE + (lastEncoderPosition * (MEM_MSG_SIZE + 1));
+                memData = eeprom_read(memAddr);
+                
+                if(memData == END_OF_MESSAGE)
+                {
+                    printStr("Empty slot");
+                }
+                else if(memData == FIST_MARKER)
+                {
+                    printStr("Fist recording");
+                }
+                else 
+                {
+                    // The selected slot has content. Preview first few characters in display.
+                    memPos = 1;
+                    printChar(memData);
+
+                    while(memPos < (MAX_DISPLAY_LENGTH -1))
+                    {
+                        memData = eeprom_read(++memAddr);
+                        if(memData == END_OF_MESSAGE)
                         {
                             break;
                         }
-          
-                        // Lets keep 21 units of spacing between each message. 
-                        while(waitTimeCount < 21)
-                        {
-                            waitTimeCount++;
-                            currentInputStatus = PORTB & PORTB_MASK;
-                            
-                            // Update looping progress indicator.
-                            if((waitTimeCount % 3) == 0)
-                            {
-                                printChar(0xFF);
-                            }
-                            
-                            unitDelay();
-                            
-                            // Check for cancel action from user.
-                            if((currentInputStatus & BTN_MEM_MANAGER) == 0x00)
-                            {
-                                clearRow(2);
-                                printStr("CANCEL");
-
-                                while((PORTB & BTN_MEM_MANAGER) == 0x00)
-                                {
-                                    __delay_ms(10);
-                                }
-
-                                currentInputStatus = PORTB & PORTB_MASK;
-                                lastInputStatus = currentInputStatus;
-                                userCancel = TRUE;
-                                
-                                __delay_ms(150);
-                                break;
-                            }
-                            
-                        }
-                        
-                        clearRow(2);
-                        clearScrollBuffer();
-                        lastInputStatus = PORTB & PORTB_MASK;
-                    }
-                    else 
-                    {
-                        // Looping is not active.
-                        break;
+                        printChar(memData);
+                        memPos++;
                     }
-                    
-                    // Handle cancel state issued by the user.
-                    if(userCancel == TRUE)
+
+                    // Message length is higher than the display buffer.
+                    if(memPos >= MAX_DISPLAY_LENGTH - 1) 
                     {
-                        __delay_ms(10);
-                        break;
+                        printChar(0x7E);
                     }
                 }
+                break;
                 
-                clearLCD();
-                setCursor(1, 1);
-                printStr("Memory slot");
-                lastEncoderPosition = ROTARY_ENCODER_END;
+            case SCREEN_RECORD:
+                printStr((fistRecording == TRUE) ? "Recording fist" : "Recording...");
+                clearScrollBuffer();
+                break;
+        }
+        
+        return;
+    }
+    
+    if(displayChar != 0)
+    {
+        switch(uiScreen)
+        {
+            case SCREEN_MAIN:
+                printWindow(displayChar);
+                break;
+                
+            case SCREEN_PLAYBACK:
+                if(displayChar == 0xFF)
+                {
+                    // Looping progress indicator.
+                    printChar(0xFF);
+                }
+                else
+                {
+                    printScroll(displayChar);
+                }
+                break;
+                
+            case SCREEN_RECORD:
+                printScroll(displayChar);
+                
+                // Last 10 blocks of the memory space is reached and inform this to user.
+                if(recCount < 10)
+                {
+                    setCursor(1, MAX_DISPLAY_LENGTH);
+                    printChar(recCount + 48);
+                }
+                break;
+        }
+        
+        // Characters released in other screens are not displayed.
+        displayChar = 0;
+    }
+    
+    if(uiScreen == SCREEN_MAIN)
+    {
+        meterTask();
+    }
+}
+
+// Typeahead buffer fill and keying speed meters of the main screen.
+void meterTask()
+{
+    unsigned char queueLength = getBufferCount(&dataBuffer);
+    unsigned char markTicks = keyMarkTicks;
+    unsigned short sampleQuarters;
+    unsigned char level;
+    unsigned char speed;
+    
+    // Mark longer than 2 units is taken as a dash. Unit length is averaged over 
+    // the last few marks, so the meter follows the operator and not the setting.
+    if(markTicks != 0)
+    {
+        keyMarkTicks = 0;
+        sampleQuarters = (unsigned short)markTicks << 2;
+        
+        if(sampleQuarters > (keyUnitQuarters << 1))
+        {
+            sampleQuarters /= 3;
+        }
+        
+        keyUnitQuarters = ((keyUnitQuarters * 3) + sampleQuarters) >> 2;
+    }
+    
+    // Any queued character shows the lowest bar.
+    level = (queueLength == 0) ? 0 : ((((unsigned short)queueLength * METER_LEVELS) + dataBuffer.size - 1) / dataBuffer.size);
+    
+    if((operatingMode == MODE_HOST) || (keyerTypeId != 0x0000) || (keyUnitQuarters == 0))
+    {
+        // Host text and paddle elements are sent with the selected speed.
+        speed = 5 * (keyTiming.speed + 1);
+    }
+    else
+    {
+        // WPM is 1200 / unit length in milliseconds (2.5ms steps).
+        speed = (keyUnitQuarters < 5) ? 99 : (480 / keyUnitQuarters);
+    }
+    
+    updateMeter(level, speed);
+}
+
+void cancelPlayback()
+{
+    // Stop the message at the element boundary and show the cancel notice.
+    stopTransmitter();
+    
+    // Drop pending serial number digits and restore the speed changed by macros.
+    macroPos = 4;
+    keySpeed = playSpeed;
+    
+    playState = PLAY_CANCEL;
+    uiTimeout = 3;
+    lcdRedraw = TRUE;
+}
+
+unsigned char claimArena(unsigned char owner)
+{
+    unsigned char status;
+    
+    if(arenaOwner == owner)
+    {
+        return TRUE;
+    }
+    
+    // Buffer positions are not changed while the host abort is pending.
+    if(txControl & TX_ABORT)
+    {
+        return FALSE;
+    }
+    
+    GIE = 0;
+    status = resizeBuffer(&dataBuffer, (owner == ARENA_QUEUE) ? (RING_BUFFER_SIZE + ARENA_QUEUE_SIZE) : RING_BUFFER_SIZE);
+    GIE = 1;
+    
+    if(status != 0)
+    {
+        return FALSE;
+    }
+    
+    arenaOwner = owner;
+    return TRUE;
+}
+
+void flushHostBuffer()
+{
+    // Drop characters queued before the abort request and release the transmit path.
+    dataBuffer.readPos = flushPos;
+    txControl = 0x00;
+}
+
+// Memory slot transfer requested by the host. Slot is read straight from the 
+// E2PROM and written through the message buffer in the RAM arena.
+void slotTransferTask()
+{
+    unsigned char memData;
+    
+    switch(slotState)
+    {
+        case SLOT_READ:
+            // Pending message write is completed before the slot is read. Reply waits 
+            // until the other host replies are completed.
+            while((isMemoryBusy() == FALSE) && claimReply(REPLY_SLOT))
+            {
+                memData = eeprom_read(MEM_MSG_BASE + (slotNumber * (MEM_MSG_SIZE + 1)) + (slotDigits >> 1));
+                
+                if((memData == END_OF_MESSAGE) || ((slotDigits >> 1) >= MEM_MSG_SIZE))
+                {
+                    slotReply = "\r\n";
+                    slotState = SLOT_REPLY;
+                    break;
+                }
+                
+                // High digit first, continue in the next period if the UART buffer is full.
+                memData = (slotDigits & 0x01) ? (memData & 0x0F) : (memData >> 4);
+                if(sendChar((memData < 10) ? (memData + 48) : (memData + 55)) != 0)
+                {
+                    return;
+                }
+                
+                slotDigits++;
+            }
+            break;
+        case SLOT_WRITE:
+            // Message buffer is available only on the main screen. Last message 
+            // write is completed before the buffer is reused.
+            if((uiScreen == SCREEN_MAIN) && (playState == PLAY_IDLE) && claimArena(ARENA_MESSAGE))
+            {
+                // Host sends the message data after the prompt.
+                if((isMemoryBusy() == FALSE) && (replyOwner == REPLY_NONE) && (sendChar('>') == 0))
+                {
+                    slotTimeout = SLOT_TIMEOUT_TICKS;
+                    slotState = SLOT_RECEIVE;
+                }
+                return;
+            }
+            
+            slotReply = "?\r\n";
+            slotState = SLOT_REPLY;
+            break;
+        case SLOT_RECEIVE:
+            // Host is gone in the middle of the message. Reject the upload and give 
+            // the message buffer back to the typeahead buffer.
+            if((--slotTimeout) == 0)
+            {
+                GIE = 0;
+                
+                if(slotState == SLOT_RECEIVE)
+                {
+                    slotDigits = SLOT_DIGITS_ERROR;
+                    slotState = SLOT_STORE;
+                }
+                
+                GIE = 1;
+            }
+            return;
+        case SLOT_STORE:
+            if((slotDigits == SLOT_DIGITS_ERROR) || (slotDigits & 0x01))
+            {
+                slotReply = "?\r\n";
+            }
+            else
+            {
+                eepromBuffer[slotDigits >> 1] = END_OF_MESSAGE;
+                saveMsgBuffer(eepromBuffer, slotNumber);
+                slotReply = "OK\r\n";
+            }
+            
+            slotState = SLOT_REPLY;
+            break;
+    }
+    
+    if((slotState != SLOT_REPLY) || (claimReply(REPLY_SLOT) == FALSE))
+    {
+        return;
+    }
+    
+    while(*slotReply != 0)
+    {
+        if(sendChar(*slotReply) != 0)
+        {
+            return;
+        }
+        
+        slotReply++;
+    }
+    
+    slotState = SLOT_IDLE;
+    replyOwner = REPLY_NONE;
+}
+
+static inline void postButtonEvent(unsigned char eventCode)
+{
+    unsigned char newPos = (buttonEventWrite + 1) & (BUTTON_EVENT_SIZE - 1);
+    
+    // Events are dropped if the input task is not draining the queue.
+    if(newPos != buttonEventRead)
+    {
+        buttonEventQueue[buttonEventWrite] = eventCode;
+        buttonEventWrite = newPos;
+    }
+}
+
+void resetButtonState()
+{
+    // Take current button state as the debounced state without raising events.
+    buttonState = (~PORTB) & BUTTON_MASK;
+    buttonCount0 = 0;
+    buttonCount1 = 0;
+    buttonHoldTicks = 0;
+    buttonLongPressed = buttonState;
+    buttonEventRead = buttonEventWrite;
+}
+
+// Timer 0 - 250Hz (4ms) interrupt handler (reserved for low priority routines).
+static inline void isrTimer0()
+{
+    unsigned char buttonSample;
+    unsigned char buttonMask;
+    
+    // Check rotary encoder status.
+    if((PORTB & 0x03) != 0x03)
+    {
+        if((!RB0) && (lastEncoderVal))
+        {
+            if(RB1)
+            {
+                encoderPosition++;
+            }
+            else 
+            {
+                encoderPosition = (encoderPosition > 0) ? (encoderPosition - 1) : ROTARY_ENCODER_END;
+            }
+        }
+    }
+    
+    // Debounce PORTB buttons with 2-bit vertical counters. Button state changes
+    // after 4 identical samples (16ms).
+    buttonSample = ((~PORTB) & BUTTON_MASK) ^ buttonState;
+    buttonCount1 = (buttonCount1 ^ buttonCount0) & buttonSample;
+    buttonCount0 = (~buttonCount0) & buttonSample;
+    buttonSample &= ~(buttonCount0 | buttonCount1);
+    
+    if(buttonSample != 0)
+    {
+        buttonState ^= buttonSample;
+        buttonHoldTicks = 0;
+        
+        // Raise press and release events for each changed button.
+        for(buttonMask = BTN_ROTARY_ENCODER; buttonMask < 0x80; buttonMask <<= 1)
+        {
+            if(buttonSample & buttonMask)
+            {
+                postButtonEvent(buttonMask | ((buttonState & buttonMask) ? BTN_EVT_PRESS : BTN_EVT_RELEASE));
+            }
+        }
+    }
+    else if(buttonState != 0)
+    {
+        // Measure hold time of the pressed button(s) for long press and repeat events.
+        if(buttonHoldTicks < BUTTON_LONG_TICKS)
+        {
+            if((++buttonHoldTicks) == BUTTON_LONG_TICKS)
+            {
+                postButtonEvent(buttonState | BTN_EVT_LONG_PRESS);
+                buttonRepeatTicks = BUTTON_REPEAT_TICKS;
+            }
+        }
+        else if((--buttonRepeatTicks) == 0)
+        {
+            postButtonEvent(buttonState | BTN_EVT_REPEAT);
+            buttonRepeatTicks = BUTTON_REPEAT_TICKS;
+        }
+    }
+    
+    // Increase sleep counter to detect system idle.
+    if(sleepCounter < MAX_SHORT)
+    {
+        sleepCounter++;
+    }
+    
+    // Restore timer 0 with 250Hz timing cycles.
+    lastEncoderVal = RB0; 
+    TMR0 = 6;
+    T0IF = 0;
+}
+
+// Timer 1 - 100Hz (10ms) interrupt handler for time based events.
+static inline void isrTimer1()
+{
+    static unsigned char holdCounter = 0;
+    static unsigned char lastMorseCode = 0;
+    static unsigned char flagChar = TRUE;
+    static unsigned char flagWord = TRUE;
+    static unsigned char releaseCounter = MAX_BYTE;
+    static unsigned char glitchCounter = 0;
+    
+    unsigned char tempDecodeChar;
+    unsigned char keySample;
+    
+    // Time base of the event trace. Mode changes are picked up here, so all 
+    // the trace entries are written from the ISRs.
+    if(traceElapsed < TRACE_GAP)
+    {
+        traceElapsed++;
+    }
+    
+    if(operatingMode != traceMode)
+    {
+        traceMode = operatingMode;
+        traceEvent(TRACE_STATE | TRACE_MODE | traceMode);
+    }
+    
+    // Keep 8MHz clock while keying, text, display or memory activity is pending. 
+    // Key edge is checked without the glitch filter to restore the clock at once.
+    updateSystemClock((txPattern != 0) || (pttState != PTT_IDLE) || (envelopeStep != 0) || (playState != PLAY_IDLE) || 
+        (dataBuffer.readPos != dataBuffer.writePos) || (txReadPos != txWritePos) || (memJobCount > 0) || 
+        (displayChar != 0) || (lcdRedraw == TRUE) || (buttonState != 0) || ((PORTB & keyerPortMask) != keyerPortMask));
+    
+    if(operatingMode != MODE_HOST)
+    {
+        // Glitch filter: key state change is accepted only after it persists 
+        // longer than the minimum mark (key down) or minimum space (key up).
+        keySample = PORTB & keyerPortMask;
+        
+        if(keySample == keyFiltered)
+        {
+            glitchCounter = 0;
+        }
+        else if((++glitchCounter) > ((keySample == keyerPortMask) ? keyMinSpace : keyMinMark))
+        {
+            keyFiltered = keySample;
+            glitchCounter = 0;
+            
+            traceEvent(TRACE_STATE | ((keySample == keyerPortMask) ? TRACE_KEY_UP : TRACE_KEY_DOWN));
+        }
+        
+        if(operatingMode == MODE_DUAL)
+        {
+            if(keyFiltered != keyerPortMask)
+            {
+                // Manual key preempts host text and memory playback at once.
+                if(breakInTicks == 0)
+                {
+                    abortTransmitter();
+                }
+                
+                breakInTicks = keyTiming.wordGapThreshold;
+            }
+            else if(breakInTicks > 0)
+            {
+                // Queued text is resumed after a word gap of key silence.
+                breakInTicks--;
             }
         }
         
-        // Toggle MEM button to close the memory manager.
-        if(IS_BUTTON_PRESS(BTN_MEM_MANAGER))
-        {
-            __delay_ms(50);
-            break;
-        }
-        
-        // Watch button hold down counter to initiate the recording session.
-        if((currentInputStatus & BTN_MEM_MANAGER) == 0x00)
+        if(keyFiltered == keyerPortMask)
         {
-            buttonHoldCounter++;
+            // KEY UP state.
             
-            if(buttonHoldCounter >= 60)
+            // Count key release (idle) time.
+            if(releaseCounter < MAX_BYTE)
             {
-                buttonHoldCounter = 0;
-                memAddr = 0;
-                charCount = MEM_MSG_SIZE;
-                
-                // Start recording session. In here recording routine is in the 
-                // same function to save the stack.
-                clearLCD();
-                setCursor(1, 1);
-                printStr("Recording...");
+                releaseCounter++;
+            }
 
-                clearScrollBuffer();
-                
-                while((PORTB & BTN_MEM_MANAGER) == 0x00)
+            if((releaseCounter > keyTiming.unitTicks) && (lastMorseCode != CODE_EMPTY))
+            {
+                // End of morse signal reached, add the element to the pattern.
+                if(decodePattern < DECODE_FULL)
                 {
-                    __delay_ms(10);
+                    decodePattern = (decodePattern << 1) | ((lastMorseCode == CODE_DASH) ? 1 : 0);
+                    traceEvent(TRACE_STATE | ((lastMorseCode == CODE_DASH) ? TRACE_DASH : TRACE_DOT));
                 }
-
-                __delay_ms(20);
-                lastInputStatus = PORTB & PORTB_MASK;
-                
-                while(1)
+                else
                 {
-                    currentInputStatus = PORTB & PORTB_MASK;
+                    traceEvent(TRACE_STATE | TRACE_MORSE_FULL);
+                }
+                
+                lastMorseCode = CODE_EMPTY;
+            }
 
-                    // Wait for stop action (cancel) from user.
-                    if(IS_BUTTON_PRESS(BTN_MEM_MANAGER))
+            if((releaseCounter > keyTiming.charGapThreshold) && (flagChar == FALSE))
+            {
+                // End of character reached.
+                tempDecodeChar = (decodePattern < DECODE_TABLE_SIZE) ? decodeTable[decodePattern] : '?';
+                if(tempDecodeChar > 0)
+                {
+                    traceEvent(TRACE_DECODE | TRACE_CHAR(tempDecodeChar));
+                    
+                    // In dual mode typeahead buffer holds the host text.
+                    if(operatingMode == MODE_DUAL)
                     {
-                        __delay_ms(150);
-                        break;
+                        decodedChar = tempDecodeChar;
                     }
-
-                    // Rotary encoder button event to save captured message to the memory.
-                    if(IS_BUTTON_PRESS(BTN_ROTARY_ENCODER))
+                    else if(pushToBuffer(&dataBuffer, tempDecodeChar) == 0)
                     {
-                        eepromBuffer[memAddr] = END_OF_MESSAGE;
-                        saveMsgBuffer(eepromBuffer, encoderPosition);
-
-                        __delay_ms(10);
-                        break;
+                        traceEvent(TRACE_PUSH | TRACE_CHAR(tempDecodeChar));
                     }
-
-                    // Last 10 blocks of the memory space is reached and inform this to user.
-                    if(charCount < 10)
+                    else
                     {
-                        setCursor(1, MAX_DISPLAY_LENGTH);
-                        printChar(charCount + 48);
+                        traceEvent(TRACE_DROP | TRACE_CHAR(tempDecodeChar));
                     }
+                }
 
-                    // Check end of memory space.
-                    if(charCount > 0)
-                    {
-                        // Record user inputs into temporary memory buffer.
-                        if(operatingMode == 0x0000)
-                        {
-                            // System is in USB mode.
-                            if(popFromBuffer(&dataBuffer, &currentChar) == 0)
-                            {
-                                printScroll(currentChar);
-                                encodeCharacter(currentChar);
-                                charCount--;
-
-                                eepromBuffer[memAddr] = currentChar;
-                                memAddr++;
-                            }
-                        }
-                        else 
-                        {
-                            // System is in KEY mode.
-                            generateMorseOutput();
-
-                            if(popFromBuffer(&dataBuffer, &currentChar) == 0)
-                            {
-                                printScroll(currentChar);
-                                charCount--;
+                decodePattern = DECODE_EMPTY;
+                flagChar = TRUE;
+            }
 
-                                eepromBuffer[memAddr] = currentChar;
-                                memAddr++;
-                            }
-                        }
-                    }
+            if((releaseCounter > keyTiming.wordGapThreshold) && (flagWord == FALSE))
+            {
+                // End of word reached and pushed SPACE into the buffer.
+                if(operatingMode == MODE_DUAL)
+                {
+                    decodedChar = 32;
+                }
+                else if(pushToBuffer(&dataBuffer, 32) == 0)
+                {
+                    traceEvent(TRACE_PUSH | TRACE_CHAR(32));
+                }
+                else
+                {
+                    traceEvent(TRACE_DROP | TRACE_CHAR(32));
+                }
+                
+                flagWord = TRUE;
+                
+                // Close the last element of the fist recording with a word gap.
+                if(fistHold > 0)
+                {
+                    fistMarkTicks = fistHold;
+                    fistSpaceTicks = releaseCounter;
+                    fistHold = 0;
+                }
+            }
 
-                    lastInputStatus = currentInputStatus;
+            // Detect last key down time and decode morse symbol from that.
+            if(holdCounter > 0)
+            {
+                if(keyerTypeId == 0x0000)
+                {
+                    // Generic morse code key handler to determine keyed symbol.
+                    lastMorseCode = (holdCounter >= keyTiming.dahThreshold) ? CODE_DASH : CODE_DOT;
+                    keyMarkTicks = holdCounter;
                 }
                 
-                // End of recording session.
-                clearLCD();
-                setCursor(1, 1);
-                printStr("Memory slot");
-                lastEncoderPosition = ROTARY_ENCODER_END;
+                // Mark length is released to the fist recorder with the following space.
+                if(fistRecording == TRUE)
+                {
+                    fistHold = holdCounter;
+                }
+
+                holdCounter = 0;
             }
         }
-        
-        // Change slot and display it's content if available.
-        if(lastEncoderPosition != encoderPosition)
+        else 
         {
-            if(encoderPosition == 6)
+            // KEY DOWN state.   
+            if(holdCounter < MAX_BYTE)
             {
-                encoderPosition = 0;
+                holdCounter++;
             }
-            else if(encoderPosition == ROTARY_ENCODER_END)
+
+            if(keyerTypeId == 0x0000)
             {
-                encoderPosition = 5;
+                // For normal key, wait until user hold the key to determine the symbol.
+                lastMorseCode = CODE_EMPTY;
             }
-            
-            lastEncoderPosition = encoderPosition;
-            setCursor(1, 13);
-            printChar(encoderPosition + 49);
-            
-            // Try to preview content of the slot.
-            memAddr = MEM_MSG_BASE + (encoderPosition * (MEM_MSG_SIZE + 1));
-            memData = eeprom_read(memAddr);
-            clearRow(2);            
-            
-            if(memData == END_OF_MESSAGE)
+            else 
             {
-                printStr("Empty slot");
+                // Detect which paddle is keyed.
+                lastMorseCode = ((keyFiltered & 0x10) == 0x00) ? CODE_DASH : CODE_DOT;
             }
-            else 
+
+            // Pass the last mark and the following space to the fist recorder.
+            if(fistHold > 0)
             {
-                // The selected slot has content. Preview first few characters in display.
-                memPos = 1;
-                printChar(memData);
-                
-                while(memPos < (MAX_DISPLAY_LENGTH -1))
+                fistMarkTicks = fistHold;
+                fistSpaceTicks = releaseCounter;
+                fistHold = 0;
+            }
+            
+            releaseCounter = 0;
+            flagChar = FALSE;
+            flagWord = FALSE;
+        }
+        
+        // Drive key and paddle outputs while memory playback and transmit engine are 
+        // idle, or while the operator breaks in.
+        if(((playState == PLAY_IDLE) || (breakInTicks > 0)) && (txPattern == 0))
+        {
+            if(keyerTypeId == 0x0000)
+            {
+                // Handle generic morse keyer.
+                if(keyFiltered == keyerPortMask)
                 {
-                    memData = eeprom_read(++memAddr);
-                    if(memData == END_OF_MESSAGE)
-                    {
-                        break;
-                    }
-                    printChar(memData);
-                    memPos++;
+                    disablePulse();
                 }
-                
-                // Message length is higher than the display buffer.
-                if(memPos >= MAX_DISPLAY_LENGTH - 1) 
+                else 
                 {
-                    printChar(0x7E);
+                    enablePulse();
                 }
             }
+            else if(keyFiltered != keyerPortMask)
+            {
+                // Handle paddle type morse keyer and emit element based on active paddle.
+                txSpacing = keyTiming.unitTicks;
+                txPattern = ((keyFiltered & 0x10) == 0x00) ? PATTERN_DAH : PATTERN_DIT;
+            }
         }
-        
-        __delay_ms(20);
-        lastInputStatus = currentInputStatus;
     }
+    
+    // Advance transmit engine and release the scheduler tasks.
+    updatePTT();
+    updateTransmitter();
+    schedulerTick();
+    
+    // Restore timer 1 with 100Hz timing cycles.
+    TMR1H = keyTiming.reloadHigh;
+    TMR1L = keyTiming.reloadLow;
+    TMR1IF = 0;
 }
 
-void systemMenuHandler() 
+// UART data receive interrupt handler.
+static inline void isrUART()
 {
-    signed char lastEncoderPosition = ROTARY_ENCODER_END;
-    char *subMenuItemList[3];
-    char *subMenuTitle = 0;
-    unsigned char subMenuItemCount = 0;
-    unsigned char optPosition = 0;
-    unsigned short optTemp;
-    unsigned char tempEncoderPos = 0;
-
-    // Sub menu items.
-    char *menuInputMode = "Input mode";
-    char *menuKeyerType = "Keyer type";
-    char *menuMorseSpeed = "Morse speed";
-    char *menuSpeakerOut = "Speaker out";
-    char *menuRepeatPlay = "Send in loop";
-    char *menuKeyingType = "Keying type";
-    
-    clearLCD();
-    setCursor(1, 1);
-    printStr("System settings");
-    
-    lastInputStatus = PORTB & PORTB_MASK;
-    encoderPosition = 0;
+    unsigned char tempData;
     
-    while(1)
+    // First byte from the host restores the 8MHz clock.
+    if(clockMode != CLOCK_FAST)
+    {
+        setSystemClock(CLOCK_FAST);
+    }
+    
+    tempData = readChar();
+    
+    // Overrun stops the receiver until the receive logic is reset. Bytes in the 
+    // FIFO are read before the reset.
+    if(OERR)
     {
-        currentInputStatus = PORTB & PORTB_MASK;
+        CREN = 0;
+        CREN = 1;
         
-        // Rotary encoder button pressed. Open the system menu.
-        if(IS_BUTTON_PRESS(BTN_ROTARY_ENCODER))
+        if(rxOverrunCount < MAX_BYTE)
         {
-            __delay_ms(50);
-            
-            switch(encoderPosition)
-            {
-                case 0: 
-                    // Input mode sub menu.
-                    subMenuItemList[0] = "Host terminal";
-                    subMenuItemList[1] = "Keyer";
-                    subMenuItemCount = 2;
-                    subMenuTitle = menuInputMode;
-                    optPosition = OPT_INPUT_MODE;
-                    break;
-                case 1:
-                    // Keyer type sub menu.
-                    subMenuItemList[0] = "Morse key";
-                    subMenuItemList[1] = "Morse paddle";
-                    subMenuItemCount = 2;
-                    subMenuTitle = menuKeyerType;
-                    optPosition = OPT_KEYER_TYPE;
-                    break;
-                case 2:
-                    // WPM selection sub menu.
-                    subMenuItemList[0] = "5 WPM";
-                    subMenuItemList[1] = "10 WPM";
-                    subMenuItemList[2] = "15 WPM";
-                    subMenuItemCount = 3;
-                    subMenuTitle = menuMorseSpeed;
-                    optPosition = OPT_SPEED;
-                    break;
-                case 3:
-                    // Speaker status sub menu.
-                    subMenuItemList[0] = "Active";
-                    subMenuItemList[1] = "Mute";
-                    subMenuItemCount = 2;
-                    subMenuTitle = menuSpeakerOut;
-                    optPosition = OPT_SPEAKER_OUT;
-                    break;
-                case 4:
-                    // Send recorded message in loop.
-                    subMenuItemList[0] = "On";
-                    subMenuItemList[1] = "Off";
-                    subMenuItemCount = 2;
-                    subMenuTitle = menuRepeatPlay;
-                    optPosition = OPT_LOOP_SEND;
-                    break;
-                case 5:
-                    // Keying type sub menu.
-                    subMenuItemList[0] = "PTT";
-                    subMenuItemList[1] = "Tone";
-                    subMenuItemList[2] = "PTT + Tone";
-                    subMenuItemCount = 3;
-                    subMenuTitle = menuKeyingType;
-                    optPosition = OPT_TONE_TYPE;
-                    break;
-                case 6:
-                    // Exit from menu system.
-                    lastInputStatus = MAX_BYTE;
-                    return;
+            rxOverrunCount++;
+        }
+    }
+    
+    // WinKeyer commands are served as the native control bytes and text.
+    if((winkeyOpen == TRUE) || (winkeyCommand != WK_IDLE) || (tempData == WK_CMD_ADMIN))
+    {
+        tempData = parseWinkeyByte(tempData);
+        if(tempData == 0)
+        {
+            return;
+        }
+    }
+    
+    // Message data of the memory slot write request.
+    if(slotState == SLOT_RECEIVE)
+    {
+        slotTimeout = SLOT_TIMEOUT_TICKS;
+        
+        if(tempData == '\r')
+        {
+            slotState = SLOT_STORE;
+        }
+        else if(tempData == CTRL_ABORT)
+        {
+            // Upload is canceled by the host.
+            slotDigits = SLOT_DIGITS_ERROR;
+            slotState = SLOT_STORE;
+        }
+        else if(slotDigits != SLOT_DIGITS_ERROR)
+        {
+            // Convert the hex digit and reject the message on the first invalid digit.
+            if((tempData > 47) && (tempData < 58))
+            {
+                tempData -= 48;
+            }
+            else if(((tempData | 0x20) > 96) && ((tempData | 0x20) < 103))
+            {
+                tempData = (tempData | 0x20) - 87;
+            }
+            else
+            {
+                tempData = MAX_BYTE;
             }
             
-            // Open selected sub menu item.
-            __delay_ms(50);
-            tempEncoderPos = encoderPosition;
-            optTemp = systemSubMenuHandler((systemConfig >> optPosition) & 0x03, subMenuTitle, subMenuItemList, subMenuItemCount);
-            
-            // Update system configuration variable with user selected options.
-            systemConfig &= ~(0x03 << optPosition);
-            optTemp &= 0x0003;
-            systemConfig |= optTemp << optPosition;
-            
-            updateSystemSettings();
-            
-            // Return to main menu from sub menu item.
-            clearLCD();
-            setCursor(1, 1);
-            lastEncoderPosition = ROTARY_ENCODER_END;
-            encoderPosition = tempEncoderPos;
-            printStr("System settings");
+            if((tempData == MAX_BYTE) || ((slotDigits >> 1) >= MEM_MSG_SIZE))
+            {
+                slotDigits = SLOT_DIGITS_ERROR;
+            }
+            else if(slotDigits & 0x01)
+            {
+                eepromBuffer[slotDigits >> 1] |= tempData;
+                slotDigits++;
+            }
+            else
+            {
+                eepromBuffer[slotDigits >> 1] = tempData << 4;
+                slotDigits++;
+            }
+        }
+        return;
+    }
+    
+    // Parameter byte of the memory slot commands.
+    if((hostCommand == CTRL_SLOT_READ) || (hostCommand == CTRL_SLOT_WRITE))
+    {
+        tempData -= '1';
+        
+        if((tempData < MEM_SLOT_COUNT) && (slotState == SLOT_IDLE))
+        {
+            slotNumber = tempData;
+            slotDigits = 0;
+            slotState = (hostCommand == CTRL_SLOT_READ) ? SLOT_READ : SLOT_WRITE;
         }
         
-        // Update LCD if rotary encoder position is changed.
-        if(lastEncoderPosition != encoderPosition)
+        hostCommand = 0;
+        return;
+    }
+    
+    // Parameter byte of the baud rate command.
+    if(hostCommand == CTRL_BAUD)
+    {
+        hostCommand = 0;
+        tempData -= '0';
+        
+        if(tempData < BAUD_RATE_COUNT)
         {
-            clearRow(2);
-            lastEncoderPosition = encoderPosition;
+            baudRequest = tempData;
+            systemConfig[OPT_BAUD_RATE] = tempData;
+            hostSaveRequest = TRUE;
+        }
+        return;
+    }
+    
+    // Host control bytes are served in both modes and bypass the typeahead buffer.
+    switch(tempData)
+    {
+        case CTRL_ABORT:
+            // Mark current tail of the buffer to flush and stop the active character.
+            flushPos = dataBuffer.writePos;
+            txControl = TX_ABORT;
+            return;
+        case CTRL_BAUD:
+        case CTRL_SLOT_READ:
+        case CTRL_SLOT_WRITE:
+            hostCommand = tempData;
+            return;
+        case CTRL_PAUSE:
+            txControl ^= TX_PAUSE;
+            return;
+        case CTRL_DIAG:
+            diagRequest = TRUE;
+            return;
+        case CTRL_TRACE:
+            // Request during a dump is dropped.
+            if(traceDumpPos == TRACE_IDLE)
+            {
+                traceDumpPos = TRACE_REQUEST;
+            }
+            return;
+        case CTRL_SPEED_UP:
+            if(keySpeed < 2)
+            {
+                keySpeed++;
+            }
+            systemConfig[OPT_SPEED] = keySpeed;
+            return;
+        case CTRL_SPEED_DOWN:
+            if(keySpeed > 0)
+            {
+                keySpeed--;
+            }
+            systemConfig[OPT_SPEED] = keySpeed;
+            return;
+        case CTRL_PTT_ON:
+            pttOverride = TRUE;
+            shadowPortC |= 0x08;
+            PORTC = shadowPortC;
+            return;
+        case CTRL_PTT_OFF:
+            pttOverride = FALSE;
             
-            switch(encoderPosition)
+            if(pttState == PTT_IDLE)
             {
-                case 0:
-                    printStr(menuInputMode);
-                    break;
-                case 1:
-                    printStr(menuKeyerType);
-                    break;
-                case 2:
-                    printStr(menuMorseSpeed);
-                    break;
-                case 3:
-                    printStr(menuSpeakerOut);
-                    break;
-                case 4:
-                    printStr(menuRepeatPlay);
-                    break;
-                case 5:
-                    printStr(menuKeyingType);
-                    break;
-                case 6:
-                    printStr("Exit");
-                    break; 
-                case ROTARY_ENCODER_END:
-                    encoderPosition = 6;
-                    break;
-                default:
-                    encoderPosition = 0;
+                shadowPortC &= 0xF7;
+                PORTC = shadowPortC;
+            }
+            return;
+    }
+    
+    // In keying mode ignore data received from the UART.
+    if(operatingMode != MODE_KEYER)
+    {
+        // Limit characters to A..Z, a..z, 0..9, SPACE and macro tokens for the memory slots.
+        if(((tempData > 47) && (tempData < 58)) || ((tempData > 64) && (tempData < 91)) || ((tempData > 96) && (tempData < 123)) || (tempData == 32) ||
+           (tempData == MACRO_SERIAL) || (tempData == MACRO_FASTER) || (tempData == MACRO_SLOWER) || (tempData == MACRO_PAUSE) || (tempData == MACRO_CHAIN))
+        {
+            if(pushToBuffer(&dataBuffer, tempData) == 0)
+            {
+                traceEvent(TRACE_PUSH | TRACE_CHAR(tempData));
+            }
+            else
+            {
+                traceEvent(TRACE_DROP | TRACE_CHAR(tempData));
             }
         }
+    }
+}
+
+// Interrupt dispatcher. Handlers and the routines they use are inlined, so the 
+// interrupt takes only it's own level of the hardware stack. Pending interrupts 
+// are served in the order of their latency limits.
+void __interrupt() systemISR()
+{
+    // UART ISR, used to capture data received from USB endpoint. Receive FIFO 
+    // holds only 2 bytes.
+    if(RCIF)
+    {
+        isrUART();
+    }
+    
+    // Timer 2 ISR, used to shape the sidetone envelope on every PWM period.
+    if(TMR2IE && TMR2IF)
+    {
+        updateEnvelope();
+    }
+    
+    // Timer 1 ISR, reserved for morse keying detection.
+    if(TMR1IF)
+    {
+        isrTimer1();
+    }
+    
+    // Timer 0 ISR, reserved for low priority tasks such as monitoring UI ports.
+    if(T0IF)
+    {
+        isrTimer0();
+    }
+}
+
+// Serial number sub menu action. "Reset to 001" restarts the contest serial 
+// numbers.
+void resetSerialAction(unsigned char option)
+{
+    if((option == 1) && (contestSerial != 1))
+    {
+        contestSerial = 1;
+        saveContestSerial();
+    }
+}
+
+// Settings loaded from an older or damaged record may be out of the option 
+// range of the menu. Such a field is set to the default option. Returns FALSE if 
+// any field is changed.
+unsigned char checkSystemSettings()
+{
+    unsigned char itemPos;
+    unsigned char status = TRUE;
+    
+    for(itemPos = 0; itemPos < MENU_ITEM_COUNT; itemPos++)
+    {
+        if(systemMenu[itemPos].action != 0)
+        {
+            continue;
+        }
         
-        lastInputStatus = currentInputStatus;
+        if(systemConfig[systemMenu[itemPos].position] >= systemMenu[itemPos].itemCount)
+        {
+            systemConfig[systemMenu[itemPos].position] = 0;
+            status = FALSE;
+        }
+    }
+    
+    return status;
+}
+
+void updateSystemSettings()
+{
+    // Update global variables based on settings value.
+    operatingMode = systemConfig[OPT_INPUT_MODE];
+    keyerTypeId = systemConfig[OPT_KEYER_TYPE];
+    keySpeed = systemConfig[OPT_SPEED];
+    keyerPortMask = ((keyerTypeId == 0x0000) ? 0x08: 0x18);
+    toneType = systemConfig[OPT_TONE_TYPE];
+    loopMessage = systemConfig[OPT_LOOP_SEND];
+    recordMode = systemConfig[OPT_REC_MODE];
+    baudRequest = systemConfig[OPT_BAUD_RATE];
+    updateTimingProfile();
+    setToneFrequency(systemConfig[OPT_TONE_FREQ]);
+    keyFiltered = keyerPortMask;
+    breakInTicks = 0;
+    
+    // Glitch filter presets (Off, Light, Normal, Heavy). Contact chatter is longer 
+    // on key closure, so minimum mark is wider than the minimum space.
+    switch(systemConfig[OPT_KEY_FILTER])
+    {
+        case 1:
+            keyMinMark = 1;
+            keyMinSpace = 1;
+            break;
+        case 2:
+            keyMinMark = 2;
+            keyMinSpace = 1;
+            break;
+        case 3:
+            keyMinMark = 3;
+            keyMinSpace = 2;
+            break;
+        default:
+            keyMinMark = 0;
+            keyMinSpace = 0;
+    }
+    
+    // PTT timing presets (Full QSK, Fast, Normal, Slow) as lead-in and hang time.
+    switch(systemConfig[OPT_PTT_TIMING])
+    {
+        case 1:
+            pttLeadTicks = 1;
+            pttHangTicks = 10;
+            break;
+        case 2:
+            pttLeadTicks = 2;
+            pttHangTicks = 30;
+            break;
+        case 3:
+            pttLeadTicks = 5;
+            pttHangTicks = 80;
+            break;
+        default:
+            pttLeadTicks = 0;
+            pttHangTicks = 0;
+    }
+    
+    // Update audio amplifier mute state.    
+    shadowPortC &= 0xEF;
+    
+    if(systemConfig[OPT_SPEAKER_OUT] != 0x00)
+    {
+        shadowPortC |= 0x10;
+    }
+    
+    PORTC = shadowPortC;
+}
+
+void updateTimingProfile()
+{
+    unsigned char unitTicks;
+    
+    // Length of the delay unit based on selected WPM.
+    switch(keySpeed)
+    {
+        case 1:
+            unitTicks = 12;
+            break;
+        case 2:
+            unitTicks = 8;
+            break;
+        default:
+            unitTicks = 24;
     }
+    
+    keyTiming.speed = keySpeed;
+    keyTiming.unitTicks = unitTicks;
+    keyTiming.dahTicks = unitTicks * 3;
+    keyTiming.dahThreshold = unitTicks * 2;
+    keyTiming.charGapThreshold = unitTicks * 4;
+    keyTiming.wordGapThreshold = unitTicks * 10;
+    keyTiming.quantumTicks = unitTicks >> 2;
+    
+    // Speed meter restarts from the selected speed.
+    keyUnitQuarters = unitTicks << 2;
 }
 
 void enableInterrupts()
@@ -977,14 +1848,49 @@ void enableInterrupts()
     INTCON = 0xE4;
 }
 
+void startSystem()
+{
+    unsigned char status;
+    
+    //Initialize all peripherals, global variables and data structures.
+    shadowPortC = PORTC;
+    initSystem();
+    
+    // Rewrite the settings record if it is migrated from the old format, damaged 
+    // or holds an option out of the menu range.
+    status = loadSystemSettings(systemConfig);
+    if((checkSystemSettings() == FALSE) || (status == FALSE))
+    {
+        saveSystemSettings(systemConfig);
+    }
+    
+    contestSerial = loadContestSerial();
+    updateSystemSettings();
+    
+    initRingBuffer(&dataBuffer);
+    decodePattern = DECODE_EMPTY;
+    initTrace();
+    initScheduler();
+    resetButtonState();
+    
+    // Enable interrupts to serve user actions. LCD is initialized later by the 
+    // LCD task, so the host and keys are served from the start.
+    diagBootTime = readBootTime();
+    enableInterrupts();
+    
+    // Activate LCD backlight.
+    shadowPortC |= 0x20;
+    PORTC = shadowPortC;
+}
+
 void initSystem()
 {
     // Set MCU internal oscillator to 8MHz. 
-    OSCCON = 0x70;
+    OSCCON = OSC_FAST;
     INTCON = 0x00;
     
     // Setting up timer0 to 250Hz.
-    OPTION_REG = 0x04;
+    OPTION_REG = T0_OPT_FAST;
     TMR0 = 6;
     
     WPUB = 0x7F;
@@ -1007,12 +1913,14 @@ void initSystem()
     CM2CON0 = 0x00;
     
     T1CON = 0x0D;
-    TMR1H = 177;
-    TMR1L = 229;
+    TMR1H = TMR1H_FAST;
+    TMR1L = TMR1L_FAST;
+    
+    // Timer 1 reload values are updated by the clock governor.
+    keyTiming.reloadHigh = TMR1H_FAST;
+    keyTiming.reloadLow = TMR1L_FAST;
     
     // Initialize peripherals which is used by the firmware.
     initUART();
     initPWM();
-    
-    initLCD();
 }
@@ -32,16 +32,155 @@
 #define BTN_PTT_OVERRIDE    0x20
 #define BTN_MEM_MANAGER     0x40
 
-#define PORTB_MASK  0xFC
-
-#define IS_BUTTON_PRESS(id) (((lastInputStatus & id) == 0x00) && (currentInputStatus & id) == id)
+#define BUTTON_MASK (BTN_ROTARY_ENCODER | BTN_PTT_OVERRIDE | BTN_MEM_MANAGER)
+
+// Debounced button event codes. Event type is in the lower 2 bits and the rest 
+// holds the button mask.
+#define BTN_EVT_PRESS       0x00
+#define BTN_EVT_RELEASE     0x01
+#define BTN_EVT_LONG_PRESS  0x02
+#define BTN_EVT_REPEAT      0x03
+#define BTN_EVT_TYPE_MASK   0x03
+
+#define BUTTON_EVENT_SIZE   4
+
+// Button hold times in Timer 0 (4ms) ticks.
+#define BUTTON_LONG_TICKS   300
+#define BUTTON_REPEAT_TICKS 50
+
+// Button events raised by the input task.
+#define EVT_ENCODER_PRESS   0x01
+#define EVT_PTT_PRESS       0x02
+#define EVT_MEM_PRESS       0x04
+#define EVT_MEM_HOLD        0x08
+#define EVT_ENCODER_REPEAT  0x10
+
+// Operating modes (input mode setting).
+#define MODE_HOST           0
+#define MODE_KEYER          1
+#define MODE_DUAL           2
+
+// User interface screens.
+#define SCREEN_MAIN         0
+#define SCREEN_MENU         1
+#define SCREEN_SUBMENU      2
+#define SCREEN_MEMORY       3
+#define SCREEN_PLAYBACK     4
+#define SCREEN_RECORD       5
+
+// Memory playback states.
+#define PLAY_IDLE           0
+#define PLAY_SENDING        1
+#define PLAY_LOOP_WAIT      2
+#define PLAY_CANCEL         3
+
+// Fist (raw timing) recording. Slot starts with the marker and each element is 
+// stored as (mark << 4) | space in quarter delay units. Space code 15 is a word gap.
+#define FIST_MARKER         0x01
+#define FIST_MAX_MARK       14
+#define FIST_WORD_SPACE     15
+#define FIST_WORD_QUANTA    28
+
+// Message macro tokens expanded during memory playback.
+#define MACRO_SERIAL        '#'     // Contest serial number (3 or more digits).
+#define MACRO_FASTER        '>'     // Increase speed until end of the message.
+#define MACRO_SLOWER        '<'     // Decrease speed until end of the message.
+#define MACRO_PAUSE         '%'     // Pause for 1 second.
+#define MACRO_CHAIN         '@'     // Continue with slot given by next digit (1 - 6).
+
+#define MACRO_PAUSE_TICKS   100
+
+// Typeahead token of the WinKeyer buffered speed change, plus the speed option 
+// (0 - 2). Host text is below 0x80.
+#define TOKEN_SPEED         0x80
+
+// System menu descriptor. Selected option is stored in the settings field given 
+// by the position, or passed to the action of a sub menu which does not change a 
+// setting.
+typedef struct
+{
+    const char *title;
+    const char * const *items;
+    unsigned char itemCount;
+    unsigned char position;
+    void (*action)(unsigned char option);
+} menuEntry;
+
+#define MENU_ITEM_COUNT     12
+#define MENU_ITEM_EXIT      MENU_ITEM_COUNT
+
+// Host control bytes which are served immediately by the UART ISR.
+#define CTRL_SPEED_DOWN     0x04    // Ctrl+D
+#define CTRL_SPEED_UP       0x06    // Ctrl+F
+#define CTRL_PAUSE          0x10    // Ctrl+P
+#define CTRL_PTT_OFF        0x12    // Ctrl+R
+#define CTRL_PTT_ON         0x14    // Ctrl+T
+#define CTRL_ABORT          0x1B    // ESC
+#define CTRL_BAUD           0x02    // Ctrl+B followed by the baud rate number (0 - 4)
+#define CTRL_DIAG           0x05    // Ctrl+E
+#define CTRL_SLOT_READ      0x07    // Ctrl+G followed by the memory slot number (1 - 6)
+#define CTRL_SLOT_WRITE     0x17    // Ctrl+W followed by the memory slot number (1 - 6)
+#define CTRL_TRACE          0x18    // Ctrl+X
+
+// Memory slot transfer with the host. Slot content is sent in hex digits and 
+// terminated with CR (to the keyer) or CR LF (to the host).
+#define SLOT_IDLE           0
+#define SLOT_READ           1
+#define SLOT_WRITE          2
+#define SLOT_RECEIVE        3
+#define SLOT_STORE          4
+#define SLOT_REPLY          5
+
+#define SLOT_DIGITS_ERROR   0xFF
+
+// Message upload is canceled after 2.5 seconds of silence on the host link.
+#define SLOT_TIMEOUT_TICKS  250
 
 volatile signed char encoderPosition = 0;
 volatile unsigned short sleepCounter = 0;
 
-unsigned char lastInputStatus = MAX_BYTE;
-unsigned char currentInputStatus = MAX_BYTE;
 unsigned char lastEncoderVal = 0;
+signed char lastEncoderPosition = ROTARY_ENCODER_END;
+
+// Vertical counter debounce state of the PORTB buttons.
+unsigned char buttonState = 0;
+unsigned char buttonCount0 = 0;
+unsigned char buttonCount1 = 0;
+unsigned short buttonHoldTicks = 0;
+unsigned char buttonRepeatTicks = 0;
+
+volatile unsigned char buttonEventQueue[BUTTON_EVENT_SIZE];
+volatile unsigned char buttonEventWrite = 0;
+volatile unsigned char buttonEventRead = 0;
+
+unsigned char buttonEvents = 0;
+unsigned char buttonLongPressed = 0;
+
+unsigned char uiScreen = SCREEN_MAIN;
+unsigned char uiTimeout = 0;
+unsigned char lcdRedraw = FALSE;
+unsigned char displayChar = 0;
+
+unsigned char menuPos = 0;
+
+volatile unsigned char playState = PLAY_IDLE;
+unsigned char playAddr = 0;
+unsigned char memSlot = 0;
+unsigned char loopWaitCount = 0;
+unsigned char recPos = 0;
+unsigned char recCount = 0;
+unsigned char playFist = FALSE;
+unsigned char playSpeed = 0;
+unsigned char serialUsed = FALSE;
+
+// Pending digits of the expanded serial number.
+unsigned char macroText[5];
+unsigned char macroPos = 4;
+
+volatile unsigned char fistRecording = FALSE;
+volatile unsigned char fistHold = 0;
+volatile unsigned char fistMarkTicks = 0;
+volatile unsigned char fistSpaceTicks = 0;
 
 unsigned char keyerPortMask = 0;
 unsigned char operatingMode = 0;
@@ -49,23 +188,62 @@ unsigned char keyerTypeId = 0;
 unsigned char keySpeed = 0;
 unsigned char toneType = 0;
 unsigned char loopMessage = 0;
+unsigned char recordMode = 0;
+
+// Key and paddle glitch filter windows in Timer 1 (10ms) ticks.
+unsigned char keyMinMark = 0;
+unsigned char keyMinSpace = 0;
+volatile unsigned char keyFiltered = MAX_BYTE;
+
+// Straight key speed meter: last mark length released by the Timer 1 ISR and the 
+// average delay unit in quarter ticks.
+volatile unsigned char keyMarkTicks = 0;
+unsigned short keyUnitQuarters = 0;
 
 unsigned char pttOverride = 0;
-unsigned char tempDecodeChar = 0;
+
+volatile unsigned char flushPos = 0;
+volatile unsigned char hostCommand = 0;
+volatile unsigned char hostSaveRequest = FALSE;
+
+// Manual key break-in state of the dual input mode.
+volatile unsigned char breakInTicks = 0;
+volatile unsigned char decodedChar = 0;
+
+volatile unsigned char slotState = SLOT_IDLE;
+volatile unsigned char slotNumber = 0;
+volatile unsigned char slotDigits = 0;
+volatile unsigned char slotTimeout = 0;
+const char *slotReply = 0;
 
 ringBuffer dataBuffer;
-morseBuffer morseCodeBuffer;
 
+void startSystem(void);
 void initSystem(void);
 void enableInterrupts(void);
 void initUART(void);
 
-void systemMenuHandler(void);
-void memoryKeyHandler(void);
-
-void generateMorseOutput(void);
-
+void keyingTask(void);
+void releaseCharacter(unsigned char outChar);
+void storeFistElement(unsigned char markTicks, unsigned char spaceTicks);
+void playFistElement(unsigned char fistCode);
+unsigned char expandMacro(unsigned char token);
+void inputTask(void);
+void uiTask(void);
+void displayTask(void);
+void meterTask(void);
+
+void cancelPlayback(void);
+void resetButtonState(void);
+
+void flushHostBuffer(void);
+void slotTransferTask(void);
+unsigned char claimArena(unsigned char owner);
+
+void resetSerialAction(unsigned char option);
+unsigned char checkSystemSettings(void);
 void updateSystemSettings(void);
+void updateTimingProfile(void);
 
 #endif	/* MAIN_H */
 
@@ -22,50 +22,179 @@
 
 #include "mem_manager.h"
 
-void saveSystemSettings(unsigned short saveBuffer)
+void saveSystemSettings(unsigned char *settings)
 {
-    unsigned short tempBuffer;
+    unsigned char bufferPos;
+    unsigned char crc = 0;
+    
+    // Complete the pending job before the record image is replaced.
+    flushMemoryJob();
+    
+    settingsBuffer[0] = SETTINGS_VERSION;
+    settingsBuffer[1] = SETTINGS_FIELDS;
     
-    // Check value of the existing configuration.
-    tempBuffer = (eeprom_read(1) << 8) & 0xFF00;
-    __delay_ms(5);
-    tempBuffer |= eeprom_read(0);
+    for(bufferPos = 0; bufferPos < SETTINGS_FIELDS; bufferPos++)
+    {
+        settingsBuffer[SETTINGS_HEADER + bufferPos] = settings[bufferPos];
+    }
     
-    // perfrom E2PROM write only if supplied value is different from existing value.
-    if(tempBuffer != saveBuffer)
+    for(bufferPos = 0; bufferPos < (SETTINGS_SIZE - 1); bufferPos++)
     {
-        eeprom_write(0, saveBuffer & 0x00FF);
-        eeprom_write(1, (saveBuffer >> 8) & 0x00FF);
+        crc = updateCRC8(crc, settingsBuffer[bufferPos]);
+    }
+    
+    settingsBuffer[SETTINGS_SIZE - 1] = crc;
+    
+    // Skip the unchanged head of the record to save the E2PROM write cycles. 
+    // CRC is the last byte, so any change rewrites the record up to the end.
+    bufferPos = 0;
+    while((bufferPos < SETTINGS_SIZE) && (eeprom_read(SETTINGS_ADDR + bufferPos) == settingsBuffer[bufferPos]))
+    {
+        bufferPos++;
+    }
+    
+    if(bufferPos < SETTINGS_SIZE)
+    {
+        memJobData = settingsBuffer + bufferPos;
+        memJobAddr = SETTINGS_ADDR + bufferPos;
+        memJobCount = SETTINGS_SIZE - bufferPos;
     }
 }
 
-unsigned short loadSystemSettings()
+// Load settings record into the given field array. Returns FALSE if the record 
+// is not valid and the settings are migrated or reset to the defaults.
+unsigned char loadSystemSettings(unsigned char *settings)
 {
-    unsigned short tempBuffer;
+    unsigned char version, fieldCount, bufferPos, tempData;
+    unsigned char crc;
+    
+    version = eeprom_read(SETTINGS_ADDR);
+    fieldCount = eeprom_read(SETTINGS_ADDR + 1);
+    
+    // Record is not written yet. Try to convert the settings of older firmware.
+    if(version == MAX_BYTE)
+    {
+        return loadLegacySettings(settings);
+    }
     
-    tempBuffer = (eeprom_read(1) << 8) & 0xFF00;
-    __delay_ms(5);
-    tempBuffer |= eeprom_read(0);
+    crc = updateCRC8(updateCRC8(0, version), fieldCount);
+    
+    if((version == SETTINGS_VERSION) && (fieldCount <= SETTINGS_MAX_FIELDS))
+    {
+        // Fields are loaded while the CRC is calculated. Fields which are not in 
+        // the record keep their default value.
+        for(bufferPos = 0; bufferPos < fieldCount; bufferPos++)
+        {
+            tempData = eeprom_read(SETTINGS_ADDR + SETTINGS_HEADER + bufferPos);
+            crc = updateCRC8(crc, tempData);
+            
+            if(bufferPos < SETTINGS_FIELDS)
+            {
+                settings[bufferPos] = tempData;
+            }
+        }
+        
+        if(crc == eeprom_read(SETTINGS_ADDR + SETTINGS_HEADER + fieldCount))
+        {
+            return (fieldCount == SETTINGS_FIELDS) ? TRUE : FALSE;
+        }
+    }
+    
+    // Damaged or unknown record, switch system to it's default configuration.
+    for(bufferPos = 0; bufferPos < SETTINGS_FIELDS; bufferPos++)
+    {
+        settings[bufferPos] = 0;
+    }
+    
+    return FALSE;
+}
+
+unsigned char loadLegacySettings(unsigned char *settings)
+{
+    unsigned long tempBuffer = 0;
+    unsigned char bufferPos = LEGACY_SETTINGS_SIZE;
+    
+    // Older firmware stores the settings word in little endian byte order.
+    while(bufferPos > 0)
+    {
+        bufferPos--;
+        tempBuffer = (tempBuffer << 8) | eeprom_read(bufferPos);
+    }
     
     // If E2PROM is empty, switch system to it's default configuration.
-    if(tempBuffer == MAX_SHORT)
+    if(tempBuffer == 0xFFFFFFFF)
+    {
+        tempBuffer = 0x00000000;
+    }
+    else if((tempBuffer >> 16) == MAX_SHORT)
     {
-        tempBuffer = 0x0000;
+        // Settings saved by the first firmware hold only the lower 16 bits.
+        tempBuffer &= MAX_SHORT;
+    }
+    
+    // Each field is a 2-bit value in the same order as the settings fields.
+    for(bufferPos = 0; bufferPos < SETTINGS_FIELDS; bufferPos++)
+    {
+        settings[bufferPos] = tempBuffer & 0x03;
+        tempBuffer >>= 2;
+    }
+    
+    return FALSE;
+}
+
+unsigned char updateCRC8(unsigned char crc, unsigned char data)
+{
+    unsigned char bitPos;
+    
+    crc ^= data;
+    
+    for(bitPos = 0; bitPos < 8; bitPos++)
+    {
+        crc = (crc & 0x80) ? ((crc << 1) ^ CRC8_POLYNOMIAL) : (crc << 1);
+    }
+    
+    return crc;
+}
+
+unsigned short loadContestSerial()
+{
+    unsigned short tempBuffer;
+    
+    tempBuffer = (eeprom_read(MEM_SERIAL_ADDR + 1) << 8) | eeprom_read(MEM_SERIAL_ADDR);
+    
+    // Empty E2PROM starts the serial numbers from 1.
+    if((tempBuffer == 0) || (tempBuffer > SERIAL_MAX))
+    {
+        tempBuffer = 1;
     }
     
     return tempBuffer;
 }
 
+void saveContestSerial()
+{
+    flushMemoryJob();
+    
+    serialBuffer[0] = contestSerial & 0x00FF;
+    serialBuffer[1] = (contestSerial >> 8) & 0x00FF;
+    
+    memJobData = serialBuffer;
+    memJobAddr = MEM_SERIAL_ADDR;
+    
+    // Serial number is incremented after each contact. Write the high byte only 
+    // when it is changed to save the E2PROM write cycles.
+    memJobCount = (eeprom_read(MEM_SERIAL_ADDR + 1) != serialBuffer[1]) ? 2 : 1;
+}
+
 void saveMsgBuffer(unsigned char* buffer, unsigned char channel)
 {
-    unsigned char memAddr = MEM_MSG_BASE + (channel * (MEM_MSG_SIZE + 1));
     unsigned char memPos = 0;
     
-    while(memPos < (MEM_MSG_SIZE + 1))
+    flushMemoryJob();
+    
+    // Message is written up to (and including) the end of message mark.
+    while(memPos < MEM_MSG_SIZE)
     {
-        eeprom_write(memAddr + memPos, buffer[memPos]);
-        __delay_ms(5);
-        
         if(buffer[memPos] == END_OF_MESSAGE)
         {
             break;
@@ -73,4 +202,39 @@ void saveMsgBuffer(unsigned char* buffer, unsigned char channel)
         
         memPos++;
     }
+    
+    memJobData = buffer;
+    memJobAddr = MEM_MSG_BASE + (channel * (MEM_MSG_SIZE + 1));
+    memJobCount = memPos + 1;
+}
+
+void flushMemoryJob()
+{
+    // Complete the pending job before the job data is replaced.
+    while(memJobCount > 0)
+    {
+        eeprom_write(memJobAddr, *memJobData);
+        
+        memJobAddr++;
+        memJobData++;
+        memJobCount--;
+    }
+}
+
+unsigned char isMemoryBusy()
+{
+    return ((memJobCount > 0) || WR) ? TRUE : FALSE;
+}
+
+void eepromTask()
+{
+    // Start one byte write per run and never wait for the write cycle.
+    if((memJobCount > 0) && (WR == 0))
+    {
+        eeprom_write(memJobAddr, *memJobData);
+        
+        memJobAddr++;
+        memJobData++;
+        memJobCount--;
+    }
 }
@@ -30,11 +30,50 @@
 
 #define END_OF_MESSAGE  0xFF
 
-unsigned char eepromBuffer[MEM_MSG_SIZE + 1];
+#define MEM_SLOT_COUNT  6
 
-unsigned short loadSystemSettings(void);
-void saveSystemSettings(unsigned short saveBuffer);
+// Settings record: version, number of fields, fields and CRC-8 of the preceding 
+// bytes. Fields added by later versions are appended to the end of the record.
+#define SETTINGS_ADDR       200
+#define SETTINGS_VERSION    2
+#define SETTINGS_HEADER     2
+#define SETTINGS_SIZE       (SETTINGS_HEADER + SETTINGS_FIELDS + 1)
+#define SETTINGS_MAX_FIELDS 52
+
+// Packed 2-bit settings word of the older firmware (low byte first).
+#define LEGACY_SETTINGS_SIZE    4
+
+#define CRC8_POLYNOMIAL 0x07
+
+// Contest serial number is stored after the legacy settings (low byte first).
+#define MEM_SERIAL_ADDR 4
+#define SERIAL_MAX      9999
+
+// Message buffer is in the RAM arena while memory screens are active.
+#define eepromBuffer (arena.message.eepromBuffer)
+
+unsigned char settingsBuffer[SETTINGS_SIZE];
+unsigned char serialBuffer[2];
+
+unsigned short contestSerial = 1;
+
+// Pending E2PROM write job served by the EEPROM task.
+unsigned char *memJobData = 0;
+unsigned char memJobAddr = 0;
+unsigned char memJobCount = 0;
+
+unsigned char loadSystemSettings(unsigned char *settings);
+unsigned char loadLegacySettings(unsigned char *settings);
+void saveSystemSettings(unsigned char *settings);
+unsigned char updateCRC8(unsigned char crc, unsigned char data);
 void saveMsgBuffer(unsigned char* buffer, unsigned char channel);
 
+unsigned short loadContestSerial(void);
+void saveContestSerial(void);
+
+void flushMemoryJob(void);
+unsigned char isMemoryBusy(void);
+void eepromTask(void);
+
 #endif	/* MEM_MANAGER_H */
 
@@ -23,48 +23,62 @@
 #include "morse.h"
 #include "pwm.h"
 
-void unitDelay()
+// Morse code patterns for A..Z and 0..9.
+const unsigned char morseTable[36] = 
 {
-    switch((systemConfig >> OPT_SPEED) & 0x03)
-    {
-        case 1:     // 120ms (10WPM)
-            __delay_ms(105);
-            break;
-        case 2:     // 80ms (15WPM)
-            __delay_ms(65);
-            break;
-        default:    // 240ms (5WPM)
-            __delay_ms(225);
-    }
-}
-
-void unitDelayEx(unsigned char unitCount)
-{
-    unsigned char delayPos;
-    
-    for(delayPos = 0; delayPos < unitCount; delayPos++)
-    {
-        unitDelay();
-    }
-}
-
-void dot()
-{
-    enablePulse();
-    unitDelay();
-    disablePulse();
-    unitDelayEx(3);
-}
+    0x06,   // A .-
+    0x11,   // B -...
+    0x15,   // C -.-.
+    0x09,   // D -..
+    0x02,   // E .
+    0x14,   // F ..-.
+    0x0B,   // G --.
+    0x10,   // H ....
+    0x04,   // I ..
+    0x1E,   // J .---
+    0x0D,   // K -.-
+    0x12,   // L .-..
+    0x07,   // M --
+    0x05,   // N -.
+    0x0F,   // O ---
+    0x16,   // P .--.
+    0x1B,   // Q --.-
+    0x0A,   // R .-.
+    0x08,   // S ...
+    0x03,   // T -
+    0x0C,   // U ..-
+    0x18,   // V ...-
+    0x0E,   // W .--
+    0x19,   // X -..-
+    0x1D,   // Y -.--
+    0x13,   // Z --..
+    0x3F,   // 0 -----
+    0x3E,   // 1 .----
+    0x3C,   // 2 ..---
+    0x38,   // 3 ...--
+    0x30,   // 4 ....-
+    0x20,   // 5 .....
+    0x21,   // 6 -....
+    0x23,   // 7 --...
+    0x27,   // 8 ---..
+    0x2F    // 9 ----.
+};
 
-void dash()
+// Decoded characters of the element patterns with up to 5 elements. Unknown 
+// patterns are decoded as '?'.
+const unsigned char decodeTable[DECODE_TABLE_SIZE] = 
 {
-    enablePulse();
-    unitDelay();
-    unitDelay();
-    unitDelay();
-    disablePulse();
-    unitDelayEx(3);
-}
+    0, 0,                                                   // Empty.
+    'E', 'T',                                               // . -
+    'I', 'A', 'N', 'M',                                     // .. .- -. --
+    'S', 'U', 'R', 'W', 'D', 'K', 'G', 'O',                 // ... to ---
+    'H', 'V', 'F', '?', 'L', '?', 'P', 'J',                 // .... to .---
+    'B', 'X', 'C', 'Y', 'Z', 'Q', '?', '?',                 // -... to ----
+    '5', '4', '?', '3', '?', '?', '?', '2',                 // ..... to ..---
+    '?', '?', '?', '?', '?', '?', '?', '1',                 // .-... to .----
+    '6', '?', '?', '?', '?', '?', '?', '?',                 // -.... to -.---
+    '7', '?', '?', '?', '8', '?', '9', '0'                  // --... to -----
+};
 
 void encodeCharacter(unsigned char character)
 {
@@ -74,297 +88,57 @@ void encodeCharacter(unsigned char character)
         character -= 32; 
     }
     
-    switch(character)
+    if(character == 32)
     {
-        case 65:    // A
-            dit; dah;
-            break;
-        case 66:    // B
-            dah; dit; dit; dit;
-            break;  
-        case 67:    // C
-            dah; dit; dah; dit;
-            break;
-        case 68:    // D
-            dah; dit; dit;
-            break;
-        case 69:    // E
-            dit;
-            break;
-        case 70:    // F
-            dit; dit; dah; dit;
-            break;
-        case 71:    // G
-            dah; dah; dit;
-            break;
-        case 72:    // H
-            dit; dit; dit; dit;
-            break;
-        case 73:    // I
-            dit; dit;
-            break;
-        case 74:    // J
-            dit; dah; dah; dah;
-            break;
-        case 75:    // K
-            dah; dit; dah;
-            break;
-        case 76:    // L
-            dit; dah; dit; dit;
-            break;
-        case 77:    // M
-            dah; dah;
-            break;
-        case 78:    // N
-            dah; dit;
-            break;
-        case 79:    // O
-            dah; dah; dah;
-            break;
-        case 80:    // P
-            dit; dah; dah; dit;
-            break;
-        case 81:    // Q
-            dah; dah; dit; dah;
-            break;
-        case 82:    // R
-            dit; dah; dit;
-            break;
-        case 83:    // S
-            dit; dit; dit;
-            break;
-        case 84:    // T
-            dah;
-            break;
-        case 85:    // U
-            dit; dit; dah;
-            break;
-        case 86:    // V
-            dit; dit; dit; dah;
-            break;
-        case 87:    // W
-            dit; dah; dah;
-            break;
-        case 88:    // X
-            dah; dit; dit; dah;
-            break;
-        case 89:    // Y
-            dah; dit; dah; dah;
-            break;
-        case 90:    // Z
-            dah; dah; dit; dit;
-            break;
-            
-        case 48:    // 0
-            dah; dah; dah; dah; dah;
-            break;
-        case 49:    // 1
-            dit; dah; dah; dah; dah;
-            break;
-        case 50:    // 2 
-            dit; dit; dah; dah; dah;
-            break;
-        case 51:    // 3
-            dit; dit; dit; dah; dah;
-            break;
-        case 52:    // 4
-            dit; dit; dit; dit; dah;
-            break;
-        case 53:    // 5
-            dit; dit; dit; dit; dit;
-            break;
-        case 54:    // 6
-            dah; dit; dit; dit; dit;
-            break;
-        case 55:    // 7
-            dah; dah; dit; dit; dit;
-            break;
-        case 56:    // 8
-            dah; dah; dah; dit; dit;
-            break;
-        case 57:    // 9
-            dah; dah; dah; dah; dit;
-            break;
-            
-        case 32:    // SPACE
-            unitDelayEx(4);
-            break;
+        // SPACE is released as 4 delay units on top of the last character spacing.
+        transmitGap(4);
+        return;
     }
-}
-
-void initMorseBuffer(morseBuffer *buffer)
-{
-    unsigned char bufferPos;
     
-    for(bufferPos = 0; bufferPos < MORSE_BUFFER_SIZE; bufferPos++)
+    txSpacing = keyTiming.dahTicks;
+    txCharacter = character;
+    
+    if((character > 64) && (character < 91))
     {
-        buffer->morseCodeBuffer[bufferPos] = 0;
+        txPattern = morseTable[character - 65];
+    }
+    else if((character > 47) && (character < 58))
+    {
+        txPattern = morseTable[character - 22];
     }
-    
-    buffer->bufferPos = 0;
 }
 
-// Implementation of initMorseBuffer for ISRs.
-void initMorseBufferISR(morseBuffer *buffer)
+void transmitGap(unsigned char unitCount)
 {
-    unsigned char bufferPos;
-    
-    for(bufferPos = 0; bufferPos < MORSE_BUFFER_SIZE; bufferPos++)
-    {
-        buffer->morseCodeBuffer[bufferPos] = 0;
-    }
-    
-    buffer->bufferPos = 0;
+    // Gap length must be in place before the engine picks up the pattern.
+    txGapTicks = keyTiming.unitTicks * unitCount;
+    txPattern = PATTERN_END;
 }
 
-unsigned char updateMorseBuffer(morseBuffer *buffer, char morseCode)
+void transmitDelay(unsigned char delayTicks)
 {
-    if(morseCode != CODE_EMPTY)
-    {
-        if(buffer->bufferPos >= MORSE_BUFFER_SIZE)
-        {
-            // More buffer is full.
-            return 1;
-        }
+    // Silent gap with fixed length in system ticks.
+    txGapTicks = delayTicks;
+    txPattern = PATTERN_END;
+}
 
-        buffer->morseCodeBuffer[buffer->bufferPos] = morseCode;
-        buffer->bufferPos++;
-    }
-    
-    return 0;
+void transmitElement(unsigned char markTicks, unsigned char spaceTicks)
+{
+    // Single mark with the recorded mark and space lengths. It is not sent 
+    // again after a break-in.
+    txMarkTicks = markTicks;
+    txSpacing = spaceTicks;
+    txCharacter = 0;
+    txPattern = PATTERN_DIT;
 }
 
-unsigned char decodeCharacter(morseBuffer *buffer)
+void stopTransmitter()
 {
-    unsigned char tempBuffer = 0;
-    unsigned char tempPos = (buffer->bufferPos - 1);
-    unsigned char tempData;
-    unsigned char shfitPos = 0;
-    
-    // Check for empty morse buffer.
-    if(buffer->bufferPos == 0)
-    {
-        return 0;
-    }
-    
-    // Reverse content of the morse buffer to start decoding.
-    while(shfitPos < buffer->bufferPos)
-    {
-        tempData = (buffer->morseCodeBuffer[tempPos--] == CODE_DOT) ? 0 : 1;
-        tempBuffer |= tempData << shfitPos;
-        shfitPos++;
-    }
+    // Drop remaining elements. Active element completes with it's spacing.
+    txGapTicks = 0;
     
-    if(buffer->bufferPos == 1)
-    {
-        // Handle more codes with single symbol.
-        switch(tempBuffer)
-        {
-            case 0:     // .
-                return 69;          // E
-            case 1:     // -
-                return 84;          // T
-        }
-    }
-    else if(buffer->bufferPos == 2)
-    {
-        // Handle more codes with 2 symbols.
-        switch(tempBuffer)
-        {
-            case 0:     // ..
-                return 73;          // I
-            case 1:     // .-
-                return 65;          // A
-            case 2:     // -.
-                return 78;          // N
-            case 3:     // --
-                return 77;          // M
-        }
-    }
-    else if(buffer->bufferPos == 3)
+    if(txPattern != 0)
     {
-        // Handle more codes with 3 symbols.
-        switch(tempBuffer)
-        {
-            case 0:     // ...
-                return 83;          // S
-            case 1:     // ..-
-                return 85;          // U
-            case 2:     // .-.
-                return 82;          // R
-            case 3:     // .--
-                return 87;          // W
-            case 4:     // -..
-                return 68;          // D
-            case 5:     // -.-
-                return 75;          // K
-            case 6:     // --.
-                return 71;          // G
-            case 7:     // ---
-                return 79;          // 0
-        }
+        txPattern = PATTERN_END;
     }
-    else if(buffer->bufferPos == 4)
-    {
-        // Handle more codes with 4 symbols.
-        switch(tempBuffer)
-        {
-            case 0:     // ....
-                return 72;         // H
-            case 1:     // ...-
-                return 86;         // V 
-            case 2:     // ..-.
-                return 70;         // F
-            case 4:     // .-..
-                return 76;         // L
-            case 6:     // .--.
-                return 80;         // P
-            case 7:     // .---
-                return 74;         // J
-            case 8:     // -...
-                return 66;         // B
-            case 9:     // -..-
-                return 88;         // X
-            case 10:    // -.-.
-                return 67;         // C
-            case 11:    // -.--
-                return 89;         // Y
-            case 12:    // --..
-                return 90;         // Z
-            case 13:    // --.-
-                return 81;         // Q
-            default:    // ---.
-                return 63;         // ? (unknown)
-        }
-    }
-    else if(buffer->bufferPos == 5)
-    {
-        // Handle more codes with 5 symbols.
-        switch(tempBuffer)
-        {
-            case 15:     // .----
-                return 49;          // 1
-            case 7:     // ..---
-                return 50;          // 2
-            case 3:     // ...--
-                return 51;          // 3
-            case 1:     // ....-
-                return 52;          // 4
-            case 0:     // .....
-                return 53;          // 5
-            case 16:     // -....
-                return 54;          // 6
-            case 24:     // --...
-                return 55;          // 7
-            case 28:     // ---..
-                return 56;          // 8
-            case 30:     // ----.
-                return 57;          // 9
-            case 31:     // -----
-                return 48;          // 0
-        }
-    }
-    
-    // Unknown symbol.
-    return 63;
 }
@@ -24,27 +24,154 @@
 #define	MORSE_H
 
 #include "global.h"
+#include "pwm.h"
 
 #define CODE_DOT    1
 #define CODE_DASH   3
 #define CODE_EMPTY  0
 
-#define dit dot()
-#define dah dash()
+// Element patterns are stored LSB first (0 - dit, 1 - dah) and terminated with a 
+// leading 1 bit. Pattern with only the terminator holds a silent gap.
+#define PATTERN_END     0x01
+#define PATTERN_DIT     0x02
+#define PATTERN_DAH     0x03
 
-void unitDelay(void);
-void unitDelayEx(unsigned char unitCount);
+// Decoder builds the pattern of the received character MSB first after a leading 
+// 1 bit, so each element is added with a single shift. Up to 6 elements are kept.
+#define DECODE_EMPTY        0x01
+#define DECODE_FULL         0x40
+#define DECODE_TABLE_SIZE   64
 
-void dot(void);
-void dash(void);
+// Keying timing profile in Timer 1 ticks. Profile is computed when the settings 
+// are changed, so the ISR does not need to multiply on every tick.
+typedef struct
+{
+    unsigned char speed;
+    unsigned char unitTicks;
+    unsigned char dahTicks;
+    unsigned char dahThreshold;
+    unsigned char charGapThreshold;
+    unsigned char wordGapThreshold;
+    unsigned char quantumTicks;
+    unsigned char reloadHigh;
+    unsigned char reloadLow;
+} timingProfile;
+
+timingProfile keyTiming;
+
+// Transmit engine state shared between keying task and Timer 1 ISR. Spacing and 
+// gap lengths are in Timer 1 ticks.
+volatile unsigned char txPattern = 0;
+volatile unsigned char txCountdown = 0;
+volatile unsigned char txKeyed = 0;
+volatile unsigned char txSpacing = 0;
+volatile unsigned char txGapTicks = 0;
+volatile unsigned char txMarkTicks = 0;
+unsigned char txCharacter = 0;
+
+volatile unsigned char decodePattern = DECODE_EMPTY;
+
+extern const unsigned char decodeTable[DECODE_TABLE_SIZE];
 
 void encodeCharacter(unsigned char character);
+void transmitGap(unsigned char unitCount);
+void transmitDelay(unsigned char delayTicks);
+void transmitElement(unsigned char markTicks, unsigned char spaceTicks);
+void stopTransmitter(void);
 
-void initMorseBuffer(morseBuffer *buffer);
-void initMorseBufferISR(morseBuffer *buffer);
+// Cut the active character immediately to serve manual break-in. This is 
+// called from Timer 1 ISR.
+static inline void abortTransmitter()
+{
+    // Partially sent character is sent again after the break-in.
+    if((txPattern > PATTERN_END) || txKeyed)
+    {
+        txControl |= TX_RESEND;
+    }
+    
+    // Mark which waits for the PTT lead-in is dropped together with the pattern.
+    if(txKeyed || keyRequest)
+    {
+        disablePulse();
+        txKeyed = FALSE;
+    }
+    
+    txPattern = 0;
+    txCountdown = 0;
+    txGapTicks = 0;
+    txMarkTicks = 0;
+}
 
-unsigned char updateMorseBuffer(morseBuffer *buffer, char morseCode);
-unsigned char decodeCharacter(morseBuffer *buffer);
+// Transmit engine, called from Timer 1 ISR on every system tick.
+static inline void updateTransmitter()
+{
+    // Wait until the active mark or space is elapsed.
+    if(txCountdown > 0)
+    {
+        if(--txCountdown > 0)
+        {
+            return;
+        }
+    }
+    
+    // Transmit engine is idle.
+    if(txPattern == 0)
+    {
+        return;
+    }
+    
+    if(txKeyed)
+    {
+        // End of the mark and keep the element spacing.
+        disablePulse();
+        txKeyed = FALSE;
+        txCountdown = txSpacing;
+        return;
+    }
+    
+    if(txGapTicks > 0)
+    {
+        txCountdown = txGapTicks;
+        txGapTicks = 0;
+        return;
+    }
+    
+    // Abort request stops the character at the element boundary.
+    if((txPattern > PATTERN_END) && ((txControl & TX_ABORT) == 0x00))
+    {
+        // Element waits while the PTT sequencer is in the lead-in period.
+        if(enablePulse() == FALSE)
+        {
+            txCountdown = pttCountdown;
+            return;
+        }
+        
+        // Handle dah (dash) with 3 delay units and dit (dot) with single delay unit.
+        txKeyed = TRUE;
+        if(txMarkTicks > 0)
+        {
+            // Element with the recorded (fist) timing.
+            txCountdown = txMarkTicks;
+            txMarkTicks = 0;
+        }
+        else
+        {
+            txCountdown = (txPattern & 0x01) ? keyTiming.dahTicks : keyTiming.unitTicks;
+        }
+        
+        txPattern >>= 1;
+        return;
+    }
+    
+    // End of the pattern. Stop and abort requests may drop the mark which waits 
+    // for the PTT lead-in, and it must not hold the PTT and the tone.
+    if(keyRequest)
+    {
+        disablePulse();
+    }
+    
+    txPattern = 0;
+}
 
 #endif	/* MORSE_H */
 
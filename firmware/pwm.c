@@ -23,45 +23,34 @@
 #include "pwm.h"
 #include "main.h"
 
+// Timer 2 period values for 750Hz, 500Hz, 600Hz and 1000Hz tones (1:16 prescaler).
+const unsigned char tonePeriod[TONE_FREQ_COUNT] = {0xA6, 0xF9, 0xCF, 0x7C};
+
+// Raised cosine duty cycle steps from silence to 50% duty cycle for each tone.
+const unsigned char envelopeTable[TONE_FREQ_COUNT][ENVELOPE_STEPS + 1] = 
+{
+    {0, 3, 12, 26, 42, 57, 71, 80, 83},
+    {0, 5, 18, 39, 63, 86, 107, 120, 125},
+    {0, 4, 15, 32, 52, 72, 89, 100, 104},
+    {0, 2, 9, 19, 31, 43, 53, 60, 62}
+};
+
 void initPWM()
 {
-    // PWM registers are configured for 750Hz output with 50% duty cycle.
+    // PWM registers are configured for 750Hz output, tone starts from silence.
     T2CON = 0x07;
     PR2 = 0xA6;
-    CCPR1L = 0x53;
+    CCPR1L = 0x00;
     CCP1CON = 0x20; 
 }
 
-void enablePulse()
-{
-    switch(toneType)
-    {
-        case 0x00:
-            // PTT only.
-            shadowPortC |= 0x08;
-            PORTC = shadowPortC;
-            break;
-        case 0x01:
-            // Tone (PWM) only.
-            CCP1CON = 0x2C;
-            break;
-        case 0x02:
-            // PTT + Tone option.
-            shadowPortC |= 0x08;
-            PORTC = shadowPortC;
-            CCP1CON = 0x2C;
-            break;
-    }
-}
-
-void disablePulse()
+void setToneFrequency(unsigned char freqId)
 {
-    // If PTT override is active, keep PTT state as it is. Otherwise release PTT state.
-    if(pttOverride != TRUE)
+    if(freqId >= TONE_FREQ_COUNT)
     {
-        shadowPortC &= 0xF7;
-        PORTC = shadowPortC;
+        freqId = 0;
     }
     
-    CCP1CON = 0x20;
+    toneFreqId = freqId;
+    PR2 = tonePeriod[freqId];
 }
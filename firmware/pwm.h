@@ -24,10 +24,203 @@
 #define	PWM_H
 
 #include "global.h"
+#include "main.h"
+
+// PTT sequencer states.
+#define PTT_IDLE        0
+#define PTT_LEAD_IN     1
+#define PTT_ACTIVE      2
+#define PTT_HANG        3
+
+// PTT lead-in and hang times in Timer 1 (10ms) ticks. Zero hang time is full QSK.
+unsigned char pttLeadTicks = 0;
+unsigned char pttHangTicks = 0;
+
+volatile unsigned char pttState = PTT_IDLE;
+volatile unsigned char pttCountdown = 0;
+volatile unsigned char keyRequest = FALSE;
+
+// Sidetone envelope rise and fall length in PWM periods.
+#define ENVELOPE_STEPS  8
+#define TONE_FREQ_COUNT 4
+
+volatile unsigned char envelopeStep = 0;
+volatile unsigned char envelopeRise = FALSE;
+unsigned char toneFreqId = 0;
+
+extern const unsigned char envelopeTable[TONE_FREQ_COUNT][ENVELOPE_STEPS + 1];
 
 void initPWM(void);
-void enablePulse(void);
-void disablePulse(void);
+void setToneFrequency(unsigned char freqId);
+
+// Keying output and envelope routines below are used only by the ISRs. They are 
+// inlined into the interrupt handler to keep it off the hardware stack.
+
+// Start tone with the rising edge of the envelope.
+static inline void startTone()
+{
+    envelopeRise = TRUE;
+    
+    if(envelopeStep < ENVELOPE_STEPS)
+    {
+        if(envelopeStep == 0)
+        {
+            CCPR1L = 0x00;
+            CCP1CON = 0x2C;
+        }
+        
+        TMR2IE = 1;
+    }
+}
+
+// Stop tone with the falling edge of the envelope.
+static inline void stopTone()
+{
+    envelopeRise = FALSE;
+    
+    if(envelopeStep > 0)
+    {
+        TMR2IE = 1;
+    }
+}
+
+// Drive PTT output line. PTT override keeps the line asserted.
+static inline void setPTT(unsigned char state)
+{
+    if(state == TRUE)
+    {
+        shadowPortC |= 0x08;
+    }
+    else if(pttOverride != TRUE)
+    {
+        shadowPortC &= 0xF7;
+    }
+    
+    PORTC = shadowPortC;
+}
+
+static inline unsigned char enablePulse()
+{
+    keyRequest = TRUE;
+    
+    // Tone only mode does not use PTT sequencer.
+    if(toneType == 0x01)
+    {
+        startTone();
+        return TRUE;
+    }
+    
+    if(pttState == PTT_IDLE)
+    {
+        setPTT(TRUE);
+        
+        if(pttLeadTicks > 0)
+        {
+            // Hold the mark until transceiver relays are settled.
+            pttState = PTT_LEAD_IN;
+            pttCountdown = pttLeadTicks;
+            return FALSE;
+        }
+    }
+    else if(pttState == PTT_LEAD_IN)
+    {
+        return FALSE;
+    }
+    
+    pttState = PTT_ACTIVE;
+    
+    if(toneType == 0x02)
+    {
+        // PTT + Tone option.
+        startTone();
+    }
+    
+    return TRUE;
+}
+
+static inline void disablePulse()
+{
+    keyRequest = FALSE;
+    stopTone();
+    
+    if(pttState == PTT_ACTIVE)
+    {
+        if(pttHangTicks > 0)
+        {
+            // Keep PTT asserted between elements and characters.
+            pttState = PTT_HANG;
+            pttCountdown = pttHangTicks;
+        }
+        else
+        {
+            // Full QSK: PTT follows each element.
+            setPTT(FALSE);
+            pttState = PTT_IDLE;
+        }
+    }
+}
+
+// PTT sequencer, called from Timer 1 ISR on every system tick.
+static inline void updatePTT()
+{
+    if((pttState == PTT_IDLE) || (pttState == PTT_ACTIVE))
+    {
+        return;
+    }
+    
+    if(--pttCountdown > 0)
+    {
+        return;
+    }
+    
+    if(pttState == PTT_LEAD_IN)
+    {
+        // Lead-in is elapsed, start the pending mark.
+        pttState = PTT_ACTIVE;
+        
+        if(keyRequest == FALSE)
+        {
+            disablePulse();
+        }
+        else if(toneType == 0x02)
+        {
+            startTone();
+        }
+    }
+    else
+    {
+        // End of the hang time.
+        setPTT(FALSE);
+        pttState = PTT_IDLE;
+    }
+}
+
+// Sidetone envelope, called from Timer 2 ISR on every PWM period while the tone 
+// is ramping. Duty cycle register is double buffered and updated at period end.
+static inline void updateEnvelope()
+{
+    if(envelopeRise)
+    {
+        CCPR1L = envelopeTable[toneFreqId][++envelopeStep];
+        
+        if(envelopeStep >= ENVELOPE_STEPS)
+        {
+            TMR2IE = 0;
+        }
+    }
+    else if(envelopeStep > 0)
+    {
+        CCPR1L = envelopeTable[toneFreqId][--envelopeStep];
+    }
+    else
+    {
+        // End of the falling edge.
+        CCP1CON = 0x20;
+        TMR2IE = 0;
+    }
+    
+    TMR2IF = 0;
+}
 
 #endif	/* PWM_H */
 
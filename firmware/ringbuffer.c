@@ -22,6 +22,8 @@
 
 #include "ringbuffer.h"
 
+// Elements beyond RING_BUFFER_SIZE are stored in the RAM arena.
+
 void initRingBuffer(ringBuffer *buffer)
 {
     unsigned char bufferPos;
@@ -33,47 +35,67 @@ void initRingBuffer(ringBuffer *buffer)
     
     buffer->readPos = 0;
     buffer->writePos = 0;
+    buffer->size = RING_BUFFER_SIZE + ARENA_QUEUE_SIZE;
 }
 
-unsigned char pushToBuffer(ringBuffer *buffer, unsigned char data)
+unsigned char popFromBuffer(ringBuffer *buffer, unsigned char *data)
 {
-    unsigned char newPos = buffer->writePos + 1;
+    unsigned char newPos = buffer->readPos + 1;
     
-    // Check for end of the ring buffer to setup continuation.
-    if(newPos >= RING_BUFFER_SIZE)
+    if(newPos >= buffer->size)
     {
         newPos = 0;
     }
     
-    if(newPos == buffer->readPos)
+    if(buffer->readPos == buffer->writePos)
     {
-        // Ring buffer is full.
+        // Ring buffer is empty.
         return 1;
     }
     
-    // Push data into ring buffer and update new position.
-    buffer->morseBuffer[buffer->writePos] = data;
-    buffer->writePos = newPos;
+    // Pop data from ring buffer and update new position.
+    if(buffer->readPos < RING_BUFFER_SIZE)
+    {
+        *data = buffer->morseBuffer[buffer->readPos];
+    }
+    else
+    {
+        *data = arena.typeahead.queue[buffer->readPos - RING_BUFFER_SIZE];
+    }
+    
+    buffer->readPos = newPos;
     return 0;
 }
 
-unsigned char popFromBuffer(ringBuffer *buffer, unsigned char *data)
+unsigned char getBufferCount(ringBuffer *buffer)
 {
-    unsigned char newPos = buffer->readPos + 1;
+    unsigned char writePos = buffer->writePos;
+    unsigned char readPos = buffer->readPos;
     
-    if(newPos >= RING_BUFFER_SIZE)
+    if(writePos >= readPos)
     {
-        newPos = 0;
+        return writePos - readPos;
     }
     
+    // Write position is wrapped around the end of the ring buffer.
+    return (buffer->size - readPos) + writePos;
+}
+
+// Change the ring buffer size, must be called with interrupts disabled.
+unsigned char resizeBuffer(ringBuffer *buffer, unsigned char newSize)
+{
     if(buffer->readPos == buffer->writePos)
     {
-        // Ring buffer is empty.
+        // Empty buffer restarts from the beginning.
+        buffer->readPos = 0;
+        buffer->writePos = 0;
+    }
+    else if((buffer->readPos > buffer->writePos) || (buffer->writePos >= newSize))
+    {
+        // Content wraps around the end or does not fit into the new size.
         return 1;
     }
     
-    // Pop data from ring buffer and update new position.
-    *data = buffer->morseBuffer[buffer->readPos];
-    buffer->readPos = newPos;
+    buffer->size = newSize;
     return 0;
 }
@@ -26,8 +26,40 @@
 #include "global.h"
 
 void initRingBuffer(ringBuffer *buffer);
-unsigned char pushToBuffer(ringBuffer *buffer, unsigned char data);
 unsigned char popFromBuffer(ringBuffer *buffer, unsigned char *data);
+unsigned char getBufferCount(ringBuffer *buffer);
+unsigned char resizeBuffer(ringBuffer *buffer, unsigned char newSize);
+
+// Typeahead buffer is filled only by the ISRs.
+static inline unsigned char pushToBuffer(ringBuffer *buffer, unsigned char data)
+{
+    unsigned char newPos = buffer->writePos + 1;
+    
+    // Check for end of the ring buffer to setup continuation.
+    if(newPos >= buffer->size)
+    {
+        newPos = 0;
+    }
+    
+    if(newPos == buffer->readPos)
+    {
+        // Ring buffer is full.
+        return 1;
+    }
+    
+    // Push data into ring buffer and update new position.
+    if(buffer->writePos < RING_BUFFER_SIZE)
+    {
+        buffer->morseBuffer[buffer->writePos] = data;
+    }
+    else
+    {
+        arena.typeahead.queue[buffer->writePos - RING_BUFFER_SIZE] = data;
+    }
+    
+    buffer->writePos = newPos;
+    return 0;
+}
 
 #endif	/* RINGBUFFER_H */
 
@@ -0,0 +1,49 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include "scheduler.h"
+
+// Task periods in Timer 1 (10ms) ticks. Deadline of each task is the release of 
+// it's next period.
+const unsigned char taskPeriod[TASK_COUNT] = 
+{
+    1,      // Keying.
+    2,      // Input.
+    1,      // UART TX.
+    1,      // EEPROM.
+    2,      // LCD.
+    5       // UI.
+};
+
+void initScheduler()
+{
+    unsigned char taskPos;
+    
+    for(taskPos = 0; taskPos < TASK_COUNT; taskPos++)
+    {
+        taskCounter[taskPos] = taskPeriod[taskPos];
+    }
+    
+    taskReady = 0;
+    taskMissed = 0;
+    deadlineMissCount = 0;
+}
@@ -0,0 +1,79 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef SCHEDULER_H
+#define	SCHEDULER_H
+
+#include "global.h"
+
+// Task identifiers in their dispatch priority order.
+#define TASK_KEYING     0x01
+#define TASK_INPUT      0x02
+#define TASK_UART_TX    0x04
+#define TASK_EEPROM     0x08
+#define TASK_LCD        0x10
+#define TASK_UI         0x20
+
+#define TASK_COUNT      6
+
+volatile unsigned char taskReady = 0;
+volatile unsigned char taskMissed = 0;
+volatile unsigned char deadlineMissCount = 0;
+
+unsigned char taskCounter[TASK_COUNT];
+
+extern const unsigned char taskPeriod[TASK_COUNT];
+
+void initScheduler(void);
+
+// Release periodic tasks, called from Timer 1 ISR on every system tick.
+static inline void schedulerTick()
+{
+    unsigned char taskPos;
+    unsigned char taskMask = 0x01;
+    
+    for(taskPos = 0; taskPos < TASK_COUNT; taskPos++)
+    {
+        if((--taskCounter[taskPos]) == 0)
+        {
+            taskCounter[taskPos] = taskPeriod[taskPos];
+            
+            // Task is still pending from it's last release and missed the deadline.
+            if(taskReady & taskMask)
+            {
+                taskMissed |= taskMask;
+                
+                if(deadlineMissCount < MAX_BYTE)
+                {
+                    deadlineMissCount++;
+                }
+            }
+            
+            taskReady |= taskMask;
+        }
+        
+        taskMask <<= 1;
+    }
+}
+
+#endif	/* SCHEDULER_H */
+
@@ -0,0 +1,95 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include "trace.h"
+#include "uart.h"
+
+void initTrace()
+{
+    unsigned char tracePos;
+    
+    for(tracePos = 0; tracePos < TRACE_BUFFER_SIZE; tracePos += 2)
+    {
+        traceBuffer[tracePos] = 0;
+        traceBuffer[tracePos + 1] = TRACE_STATE | TRACE_EMPTY;
+    }
+}
+
+// Binary dump of the trace buffer requested by the host. Recording is held until 
+// the dump is written into the UART transmit buffer.
+void traceTask()
+{
+    unsigned char data;
+    
+    if(traceDumpPos == TRACE_IDLE)
+    {
+        // Transmit buffer is owned until the last byte of the dump is sent, so the 
+        // flow control bytes are not sent ahead of the dump tail.
+        if((replyOwner == REPLY_TRACE) && (txReadPos == txWritePos))
+        {
+            replyOwner = REPLY_NONE;
+        }
+        
+        return;
+    }
+    
+    if(traceDumpPos == TRACE_REQUEST)
+    {
+        // Request waits until the other host replies are completed.
+        if(claimReply(REPLY_TRACE) == FALSE)
+        {
+            return;
+        }
+        
+        traceDumpPos = 0;
+    }
+    
+    while(traceDumpPos < TRACE_DUMP_SIZE)
+    {
+        if(traceDumpPos == 0)
+        {
+            data = TRACE_MARKER;
+        }
+        else if(traceDumpPos == 1)
+        {
+            data = traceElapsed;
+        }
+        else if(traceDumpPos == 2)
+        {
+            data = TRACE_SIZE;
+        }
+        else
+        {
+            data = traceBuffer[(traceWrite + traceDumpPos - 3) & (TRACE_BUFFER_SIZE - 1)];
+        }
+        
+        if(sendChar(data) != 0)
+        {
+            // Transmit buffer is full, continue in the next period.
+            return;
+        }
+        
+        traceDumpPos++;
+    }
+    
+    traceDumpPos = TRACE_IDLE;
+}
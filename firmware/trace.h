@@ -0,0 +1,86 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef TRACE_H
+#define	TRACE_H
+
+#include "global.h"
+
+// Event trace ring. Each entry holds the system ticks (10ms) elapsed since the 
+// previous entry and the event code. Elapsed ticks saturate at TRACE_GAP, which 
+// marks a gap of 2.55 seconds or longer. Event type is in the upper 2 bits of 
+// the code. Trace takes 20 bytes of RAM.
+#define TRACE_SIZE          8
+#define TRACE_BUFFER_SIZE   (TRACE_SIZE * 2)
+
+#define TRACE_STATE         0x00    // Key, element and mode events given below.
+#define TRACE_DECODE        0x40    // Character decoded from the key.
+#define TRACE_PUSH          0x80    // Character written into the typeahead buffer.
+#define TRACE_DROP          0xC0    // Character dropped, typeahead buffer is full.
+
+#define TRACE_KEY_UP        0x00
+#define TRACE_KEY_DOWN      0x01
+#define TRACE_DOT           0x02
+#define TRACE_DASH          0x03
+#define TRACE_MORSE_FULL    0x04    // Element dropped, Morse buffer is full.
+#define TRACE_MODE          0x08    // Operating mode in the lower 2 bits.
+#define TRACE_EMPTY         0x3F
+
+// Characters are stored as (ASCII - 32) in the lower 6 bits. Lower case letters 
+// are stored in upper case.
+#define TRACE_CHAR(c)       ((((c) < 96) ? ((c) - 32) : ((c) - 64)) & 0x3F)
+
+#define TRACE_GAP           0xFF
+
+// Dump: marker, ticks since the newest entry, number of entries and the entries 
+// from the oldest.
+#define TRACE_MARKER        0xFE
+#define TRACE_DUMP_SIZE     (3 + TRACE_BUFFER_SIZE)
+#define TRACE_IDLE          0xFF
+#define TRACE_REQUEST       0xFE
+
+// Record the event. This is a macro to keep the call depth of the ISRs, and the 
+// buffer is not changed from the dump request to the end of the dump.
+#define traceEvent(code) \
+    do \
+    { \
+        if(traceDumpPos == TRACE_IDLE) \
+        { \
+            traceBuffer[traceWrite] = traceElapsed; \
+            traceBuffer[traceWrite + 1] = (code); \
+            traceWrite = (traceWrite + 2) & (TRACE_BUFFER_SIZE - 1); \
+            traceElapsed = 0; \
+        } \
+    } while(0)
+
+unsigned char traceBuffer[TRACE_BUFFER_SIZE];
+unsigned char traceWrite = 0;
+volatile unsigned char traceElapsed = 0;
+unsigned char traceMode = TRACE_IDLE;
+
+// Dump position, or the request raised by the UART ISR.
+volatile unsigned char traceDumpPos = TRACE_IDLE;
+
+void initTrace(void);
+void traceTask(void);
+
+#endif	/* TRACE_H */
@@ -24,14 +24,74 @@
 
 void initUART()
 {
-    SPBRG = 12;
+    // 38400 baud with 16-bit baud rate generator. Clock governor loads the 
+    // selected baud rate into SPBRGH and SPBRG.
+    BAUDCTL = 0x08;
+    SPBRGH = 0;
+    SPBRG = 51;
     RCSTA |= 0x90;
     TRISC |= 0xC0;
-    TXSTA |= 0x22;
+    TXSTA |= 0x26;
 }
 
-char readChar()
+unsigned char sendChar(unsigned char data)
 {
-    while(!RCIF);
-    return RCREG;
+    unsigned char newPos = (txWritePos + 1) & (TX_BUFFER_SIZE - 1);
+    
+    if(newPos == txReadPos)
+    {
+        // Transmit buffer is full.
+        return 1;
+    }
+    
+    txBuffer[txWritePos] = data;
+    txWritePos = newPos;
+    return 0;
+}
+
+unsigned char claimReply(unsigned char owner)
+{
+    if((replyOwner != REPLY_NONE) && (replyOwner != owner))
+    {
+        return FALSE;
+    }
+    
+    replyOwner = owner;
+    return TRUE;
+}
+
+void uartTxTask(unsigned char queueLength, unsigned char queueSize)
+{
+    // Software flow control based on the level of the typeahead buffer. Flow control 
+    // bytes are held back while the binary trace dump is sent, since the host would 
+    // take them as the dump data.
+    if((replyOwner != REPLY_TRACE) && (flowPaused == FALSE) && (queueLength >= (queueSize - FLOW_HEADROOM)))
+    {
+        if(TXIF)
+        {
+            TXREG = FLOW_XOFF;
+            flowPaused = TRUE;
+        }
+        return;
+    }
+    
+    if((replyOwner != REPLY_TRACE) && (flowPaused == TRUE) && (queueLength <= FLOW_LOW_MARK))
+    {
+        if(TXIF)
+        {
+            TXREG = FLOW_XON;
+            flowPaused = FALSE;
+        }
+        return;
+    }
+    
+    // Fill transmit register and it's shift register from the transmit buffer.
+    while(TXIF && (txReadPos != txWritePos))
+    {
+        TXREG = txBuffer[txReadPos];
+        txReadPos = (txReadPos + 1) & (TX_BUFFER_SIZE - 1);
+        
+        // TXIF is updated one cycle after the TXREG write.
+        NOP();
+    }
 }
@@ -25,8 +25,39 @@
 
 #include "global.h"
 
+#define TX_BUFFER_SIZE  8
+
+#define FLOW_XON        0x11
+#define FLOW_XOFF       0x13
+
+// Typeahead buffer free space to pause the host and level to resume the host.
+#define FLOW_HEADROOM   40
+#define FLOW_LOW_MARK   8
+
+// Multi-byte replies to the host commands. Reply owner holds the transmit buffer 
+// until the reply is written, so replies and the character echo do not mix.
+#define REPLY_NONE      0
+#define REPLY_DIAG      1
+#define REPLY_TRACE     2
+#define REPLY_SLOT      3
+
+unsigned char txBuffer[TX_BUFFER_SIZE];
+unsigned char txWritePos = 0;
+unsigned char txReadPos = 0;
+unsigned char flowPaused = 0;
+volatile unsigned char rxOverrunCount = 0;
+unsigned char replyOwner = REPLY_NONE;
+
 void initUART(void);
-char readChar(void);
+unsigned char sendChar(unsigned char data);
+unsigned char claimReply(unsigned char owner);
+void uartTxTask(unsigned char queueLength, unsigned char queueSize);
+
+static inline char readChar()
+{
+    while(!RCIF);
+    return RCREG;
+}
 
 #endif	/* UART_H */
 
@@ -0,0 +1,106 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include "winkey.h"
+#include "morse.h"
+#include "uart.h"
+
+// Parameter bytes of the commands. Admin and pointer commands take more bytes 
+// based on the sub command.
+const unsigned char winkeyParamCount[WK_CMD_COUNT] = 
+{
+    1, 1, 1, 1, 2, 3, 1, 0, 0, 1, 0, 1, 1, 1, 1, 15, 
+    1, 1, 1, 0, 1, 0, 1, 1, 1, 1, 1, 2, 1, 1, 0, 0
+};
+
+const unsigned char winkeyAdminParamCount[WK_ADMIN_COUNT] = 
+{
+    1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 
+    0, 0, 0, 0, 0, 0, 1, 0, 0, 1
+};
+
+// Replies and status reports of the WinKeyer session. Status is sent when it is 
+// changed, so the host keeps the buffer filled until the XOFF flag is set.
+void winkeyTask(unsigned char queueLength, unsigned char queueSize)
+{
+    unsigned char status = WK_STATUS;
+    
+    // Status and reply bytes are not mixed into the native host replies.
+    if(replyOwner != REPLY_NONE)
+    {
+        return;
+    }
+    
+    if(winkeyReplyReady == TRUE)
+    {
+        if(sendChar(winkeyReply) != 0)
+        {
+            return;
+        }
+        
+        winkeyReplyReady = FALSE;
+    }
+    
+    if(winkeyOpen == FALSE)
+    {
+        return;
+    }
+    
+    // Buffer level uses the same limits as the XON / XOFF flow control.
+    if(queueLength >= (queueSize - FLOW_HEADROOM))
+    {
+        winkeyXoff = TRUE;
+    }
+    else if(queueLength <= FLOW_LOW_MARK)
+    {
+        winkeyXoff = FALSE;
+    }
+    
+    if(winkeyXoff)
+    {
+        status |= WK_STATUS_XOFF;
+    }
+    
+    if(breakInTicks > 0)
+    {
+        status |= WK_STATUS_BREAKIN;
+    }
+    
+    if((queueLength > 0) || (txPattern != 0))
+    {
+        status |= WK_STATUS_BUSY;
+    }
+    
+    if(txControl & TX_PAUSE)
+    {
+        status |= WK_STATUS_WAIT;
+    }
+    
+    if((status != winkeyStatus) || (winkeyStatusRequest == TRUE))
+    {
+        if(sendChar(status) == 0)
+        {
+            winkeyStatus = status;
+            winkeyStatusRequest = FALSE;
+        }
+    }
+}
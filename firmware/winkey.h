@@ -0,0 +1,243 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef WINKEY_H
+#define	WINKEY_H
+
+#include "global.h"
+#include "main.h"
+#include "ringbuffer.h"
+
+// WinKeyer (K1EL WK2) host protocol. Session is opened by the admin host open 
+// command and the native protocol is restored by the host close command.
+#define WK_VERSION          23      // Reported as WK2 version 2.3.
+
+// Commands are 0x00 - 0x1F and the rest of the bytes are text.
+#define WK_CMD_ADMIN        0x00
+#define WK_CMD_SPEED        0x02
+#define WK_CMD_PAUSE        0x06
+#define WK_CMD_GET_POT      0x07
+#define WK_CMD_BACKSPACE    0x08
+#define WK_CMD_CLEAR        0x0A
+#define WK_CMD_STATUS       0x15
+#define WK_CMD_POINTER      0x16
+#define WK_CMD_PTT          0x18
+#define WK_CMD_MERGE        0x1B
+#define WK_CMD_BUF_SPEED    0x1C
+
+#define WK_CMD_COUNT        32
+
+// Admin sub commands.
+#define WK_ADMIN_RESET      0x01
+#define WK_ADMIN_OPEN       0x02
+#define WK_ADMIN_CLOSE      0x03
+#define WK_ADMIN_ECHO       0x04
+#define WK_ADMIN_PADDLE_A2D 0x05
+#define WK_ADMIN_SPEED_A2D  0x06
+#define WK_ADMIN_LOAD_EE    0x0D
+
+#define WK_ADMIN_COUNT      26
+
+// Status byte flags. Speed pot reports are marked with WK_SPEED_POT.
+#define WK_STATUS           0xC0
+#define WK_STATUS_WAIT      0x10
+#define WK_STATUS_KEYDOWN   0x08
+#define WK_STATUS_BUSY      0x04
+#define WK_STATUS_BREAKIN   0x02
+#define WK_STATUS_XOFF      0x01
+#define WK_SPEED_POT        0x80
+
+#define WK_IDLE             0xFF
+
+// Admin argument while the EEPROM image of the load command is dropped.
+#define WK_EEPROM_DATA      0x80
+
+// Command parser state, owned by the UART ISR.
+volatile unsigned char winkeyOpen = FALSE;
+unsigned char winkeyCommand = WK_IDLE;
+unsigned char winkeyParams = 0;
+unsigned char winkeyArg = WK_IDLE;
+
+// Reply and status request raised by the UART ISR for the host link task.
+volatile unsigned char winkeyReply = 0;
+volatile unsigned char winkeyReplyReady = FALSE;
+volatile unsigned char winkeyStatusRequest = FALSE;
+
+unsigned char winkeyStatus = 0;
+unsigned char winkeyXoff = FALSE;
+
+extern const unsigned char winkeyParamCount[WK_CMD_COUNT];
+extern const unsigned char winkeyAdminParamCount[WK_ADMIN_COUNT];
+
+void winkeyTask(unsigned char queueLength, unsigned char queueSize);
+
+// Parse WinKeyer byte received by the UART ISR. Commands which have a native 
+// equivalent are returned as the native control byte, text is returned as it 
+// is and zero is returned when nothing is left to do.
+static inline unsigned char parseWinkeyByte(unsigned char data)
+{
+    unsigned char result = 0;
+    
+    if(winkeyCommand == WK_IDLE)
+    {
+        if(data >= WK_CMD_COUNT)
+        {
+            // Characters without a Morse code are dropped.
+            if(((data > 47) && (data < 58)) || ((data > 64) && (data < 91)) || ((data > 96) && (data < 123)) || (data == 32))
+            {
+                return data;
+            }
+            
+            return 0;
+        }
+        
+        winkeyCommand = data;
+        winkeyParams = winkeyParamCount[data];
+        winkeyArg = WK_IDLE;
+        
+        if(winkeyParams > 0)
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        winkeyParams--;
+        
+        if(winkeyArg == WK_IDLE)
+        {
+            // First parameter selects the length of the admin and pointer commands.
+            winkeyArg = data;
+            
+            if((winkeyCommand == WK_CMD_ADMIN) && (data < WK_ADMIN_COUNT))
+            {
+                winkeyParams += winkeyAdminParamCount[data];
+            }
+            else if((winkeyCommand == WK_CMD_POINTER) && (data > 0) && (data < 4))
+            {
+                winkeyParams++;
+            }
+        }
+        
+        // Merged letters are sent as two characters.
+        if(winkeyCommand == WK_CMD_MERGE)
+        {
+            result = data;
+        }
+        
+        if(winkeyParams > 0)
+        {
+            return result;
+        }
+    }
+    
+    // Command is complete, data holds the last parameter.
+    switch(winkeyCommand)
+    {
+        case WK_CMD_ADMIN:
+            switch(winkeyArg)
+            {
+                case WK_ADMIN_OPEN:
+                    winkeyOpen = TRUE;
+                    winkeyStatusRequest = TRUE;
+                    winkeyReply = WK_VERSION;
+                    winkeyReplyReady = TRUE;
+                    break;
+                case WK_ADMIN_RESET:
+                case WK_ADMIN_CLOSE:
+                    winkeyOpen = FALSE;
+                    break;
+                case WK_ADMIN_ECHO:
+                    winkeyReply = data;
+                    winkeyReplyReady = TRUE;
+                    break;
+                case WK_ADMIN_PADDLE_A2D:
+                case WK_ADMIN_SPEED_A2D:
+                    winkeyReply = 0;
+                    winkeyReplyReady = TRUE;
+                    break;
+                case WK_ADMIN_LOAD_EE:
+                    // 256 bytes of the EEPROM image follow, the keyer keeps its own 
+                    // settings. Parameter count wraps from zero and ends after the 
+                    // last byte.
+                    winkeyArg = WK_EEPROM_DATA;
+                    winkeyParams = 0;
+                    return 0;
+            }
+            break;
+        case WK_CMD_SPEED:
+        case WK_CMD_BUF_SPEED:
+            // Closest speed setting. Zero selects the speed pot, which is not available.
+            if(data > 0)
+            {
+                data = (data < 8) ? 0 : ((data < 13) ? 1 : 2);
+                
+                // Buffered speed change is queued with the text and applied by the 
+                // keying task when it is reached.
+                if(winkeyCommand == WK_CMD_BUF_SPEED)
+                {
+                    pushToBuffer(&dataBuffer, TOKEN_SPEED + data);
+                }
+                else
+                {
+                    keySpeed = data;
+                    systemConfig[OPT_SPEED] = keySpeed;
+                }
+            }
+            break;
+        case WK_CMD_PAUSE:
+            if(data)
+            {
+                txControl |= TX_PAUSE;
+            }
+            else
+            {
+                txControl &= ~TX_PAUSE;
+            }
+            break;
+        case WK_CMD_GET_POT:
+            winkeyReply = WK_SPEED_POT | (5 * (keySpeed + 1));
+            winkeyReplyReady = TRUE;
+            break;
+        case WK_CMD_BACKSPACE:
+            // Drop the last character which is not taken by the keying task.
+            if(dataBuffer.writePos != dataBuffer.readPos)
+            {
+                dataBuffer.writePos = ((dataBuffer.writePos == 0) ? dataBuffer.size : dataBuffer.writePos) - 1;
+            }
+            break;
+        case WK_CMD_CLEAR:
+            result = CTRL_ABORT;
+            break;
+        case WK_CMD_STATUS:
+            winkeyStatusRequest = TRUE;
+            break;
+        case WK_CMD_PTT:
+            result = data ? CTRL_PTT_ON : CTRL_PTT_OFF;
+            break;
+    }
+    
+    winkeyCommand = WK_IDLE;
+    return result;
+}
+
+#endif	/* WINKEY_H */
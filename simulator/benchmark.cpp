@@ -0,0 +1,559 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+// Decoder benchmark. Keys a generated corpus into the straight key input of the 
+// simulated firmware and compares the echoed characters with the corpus.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "hardware.h"
+#include "firmware.h"
+
+#define DEFAULT_CHARACTERS  200
+#define MAX_SETTINGS        32
+
+// Time given to the firmware to finish the boot before the first element.
+#define SETTLE_TIME         (1000 * SIM_MS)
+
+// Keyer speed settings (5, 10 and 15 WPM) and the longest word gap of the decoder.
+#define KEYER_SPEEDS        3
+#define DECODER_TAIL_TIME   (3000 * SIM_MS)
+
+// Decoder thresholds in the units of the keyer speed: element end after 1 unit of 
+// space, dash from 2 units of mark, character end after 4 units and word end after 
+// 10 units. PARIS timing of the sender fits them when the keyer speed is 10/7 
+// (7 unit word gap) to 2 (1 unit dot) times the sender speed.
+#define DECODER_MIN_RATIO   (10.0 / 7.0)
+#define DECODER_MAX_RATIO   2.0
+
+struct KeyEvent
+{
+    simTime time;
+    bool closed;
+};
+
+// Timing faults applied to the ideal PARIS timing. Jitter and weight are in 
+// percent of the sender's unit and bounce is in milliseconds.
+struct FistModel
+{
+    double jitter;
+    double weight;
+    double bounce;
+};
+
+// Result of one sender speed. Passed from the child process through a pipe.
+struct BenchResult
+{
+    unsigned int wpm;
+    unsigned int keyerWpm;
+    unsigned int characters;
+    unsigned int errors;
+    unsigned int decoded;
+    unsigned long interrupts;
+    unsigned long long interruptHostTime;
+    unsigned long long taskHostTime;
+};
+
+static const char *qCodes[] = 
+{
+    "QRL", "QRM", "QRN", "QRO", "QRP", "QRQ", "QRS", "QRT", "QRV", "QRZ", 
+    "QSB", "QSL", "QSO", "QSY", "QTH", "QTR", "CQ", "DE", "RST", "5NN", "73", "TU"
+};
+
+// Element patterns of the corpus characters (A..Z and 0..9).
+static const char *morseCodes[36] = 
+{
+    ".-", "-...", "-.-.", "-..", ".", "..-.", "--.", "....", "..", ".---", "-.-", ".-..", "--", 
+    "-.", "---", ".--.", "--.-", ".-.", "...", "-", "..-", "...-", ".--", "-..-", "-.--", "--..", 
+    "-----", ".----", "..---", "...--", "....-", ".....", "-....", "--...", "---..", "----."
+};
+
+static void printUsage(const char *name)
+{
+    fprintf(stderr, 
+        "Usage: %s [options]\n"
+        "  -w min[:max[:step]]  Sender speeds in WPM (default 3:9:3).\n"
+        "  -n count             Corpus characters per speed (default %d).\n"
+        "  -j percent           Timing jitter, standard deviation in percent of the unit.\n"
+        "  -g percent           Weight skew, marks are longer and spaces are shorter by\n"
+        "                       the given percent of the unit.\n"
+        "  -c ms                Contact bounce time after each key edge.\n"
+        "  -r seed              Random seed of the corpus and the timing faults.\n"
+        "  -s name=value        Preset a setting (see keysim). The keyer speed is\n"
+        "                       matched to the decoder thresholds unless it is given.\n"
+        "  -v                   Print the corpus and the decoded text.\n", name, DEFAULT_CHARACTERS);
+}
+
+static const char *morseCode(char character)
+{
+    if((character >= 'A') && (character <= 'Z'))
+    {
+        return morseCodes[character - 'A'];
+    }
+    
+    return morseCodes[character - '0' + 26];
+}
+
+// Corpus of random letter and digit groups, callsigns and Q-codes.
+static std::string makeCorpus(std::mt19937 &random, unsigned int length)
+{
+    static const char letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    static const char symbols[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    std::string corpus, word;
+    unsigned int wordPos;
+    
+    while(corpus.size() < length)
+    {
+        word.clear();
+        
+        switch(random() % 3)
+        {
+            case 0:
+                for(wordPos = 0; wordPos < 5; wordPos++)
+                {
+                    word += symbols[random() % 36];
+                }
+                break;
+            case 1:
+                // Callsign with 1 or 2 letter prefix, region digit and 1 to 3 letter suffix.
+                for(wordPos = (random() % 2); wordPos < 2; wordPos++)
+                {
+                    word += letters[random() % 26];
+                }
+                
+                word += (char)('0' + (random() % 10));
+                
+                for(wordPos = (random() % 3); wordPos < 3; wordPos++)
+                {
+                    word += letters[random() % 26];
+                }
+                break;
+            default:
+                word = qCodes[random() % (sizeof(qCodes) / sizeof(qCodes[0]))];
+        }
+        
+        if(!corpus.empty())
+        {
+            corpus += ' ';
+        }
+        
+        corpus += word;
+    }
+    
+    return corpus;
+}
+
+// Key edge followed by an even number of contact bounces.
+static void addEdge(std::vector<KeyEvent> &events, std::mt19937 &random, simTime edgeTime, bool closed, simTime bounceTime)
+{
+    std::uniform_int_distribution<simTime> bounceAt(0, bounceTime);
+    std::vector<simTime> bounces;
+    unsigned int bouncePos, bounceCount;
+    
+    events.push_back({edgeTime, closed});
+    
+    if(bounceTime == 0)
+    {
+        return;
+    }
+    
+    bounceCount = 2 * (1 + (random() % 3));
+    for(bouncePos = 0; bouncePos < bounceCount; bouncePos++)
+    {
+        bounces.push_back(edgeTime + bounceAt(random));
+    }
+    
+    std::sort(bounces.begin(), bounces.end());
+    
+    for(bouncePos = 0; bouncePos < bounceCount; bouncePos++)
+    {
+        events.push_back({bounces[bouncePos], ((bouncePos & 1) != 0) == closed});
+    }
+}
+
+// Key events of the corpus at the given speed, starting from the given time.
+static simTime keyCorpus(const std::string &corpus, unsigned int wpm, const FistModel &fist, std::mt19937 &random, 
+    simTime startTime, std::vector<KeyEvent> &events)
+{
+    // PARIS timing: one unit is 1200 / WPM milliseconds.
+    double unit = (1200.0 * SIM_MS) / wpm;
+    double skew = (unit * fist.weight) / 100.0;
+    std::normal_distribution<double> jitter(0.0, (unit * fist.jitter) / 100.0);
+    simTime bounceTime = (simTime)(fist.bounce * SIM_MS);
+    simTime now = startTime;
+    double mark, space;
+    size_t charPos;
+    const char *element;
+    
+    // Bounces settle well within the shortest element.
+    bounceTime = std::min(bounceTime, (simTime)(unit / 4));
+    
+    for(charPos = 0; charPos < corpus.size(); charPos++)
+    {
+        if(corpus[charPos] == ' ')
+        {
+            continue;
+        }
+        
+        for(element = morseCode(corpus[charPos]); *element != '\0'; element++)
+        {
+            mark = ((*element == '-') ? (3 * unit) : unit) + skew + jitter(random);
+            
+            // Element gap, character gap or word gap.
+            if(element[1] != '\0')
+            {
+                space = unit;
+            }
+            else if((charPos + 1) < corpus.size() && (corpus[charPos + 1] == ' '))
+            {
+                space = 7 * unit;
+            }
+            else
+            {
+                space = 3 * unit;
+            }
+            
+            space = space - skew + jitter(random);
+            
+            addEdge(events, random, now, true, bounceTime);
+            now += (simTime)std::max(mark, unit / 5);
+            addEdge(events, random, now, false, bounceTime);
+            now += (simTime)std::max(space, unit / 5);
+        }
+    }
+    
+    return now;
+}
+
+// Corpus and the decoded text are compared after dropping the repeated spaces.
+static std::string normalizeText(const std::string &text)
+{
+    std::string result;
+    
+    for(char value : text)
+    {
+        if((value == ' ') || (value == '\r') || (value == '\n'))
+        {
+            if(!result.empty() && (result.back() != ' '))
+            {
+                result += ' ';
+            }
+        }
+        else
+        {
+            result += value;
+        }
+    }
+    
+    if(!result.empty() && (result.back() == ' '))
+    {
+        result.pop_back();
+    }
+    
+    return result;
+}
+
+// Character errors as Levenshtein distance (substitutions, insertions and deletions).
+static unsigned int editDistance(const std::string &reference, const std::string &decoded)
+{
+    std::vector<unsigned int> lastRow(decoded.size() + 1), row(decoded.size() + 1);
+    size_t refPos, decPos;
+    
+    for(decPos = 0; decPos <= decoded.size(); decPos++)
+    {
+        lastRow[decPos] = decPos;
+    }
+    
+    for(refPos = 1; refPos <= reference.size(); refPos++)
+    {
+        row[0] = refPos;
+        
+        for(decPos = 1; decPos <= decoded.size(); decPos++)
+        {
+            row[decPos] = std::min(std::min(lastRow[decPos], row[decPos - 1]) + 1, 
+                lastRow[decPos - 1] + ((reference[refPos - 1] == decoded[decPos - 1]) ? 0 : 1));
+        }
+        
+        lastRow.swap(row);
+    }
+    
+    return lastRow[decoded.size()];
+}
+
+// Speed setting (0 - 5 WPM, 1 - 10 WPM, 2 - 15 WPM) which decodes the sender speed, 
+// the keyer speed closest to 5/3 times the sender speed.
+static int matchKeyerSpeed(unsigned int wpm)
+{
+    int speed = (int)((wpm + 1) / 3) - 1;
+    
+    return std::max(0, std::min(KEYER_SPEEDS - 1, speed));
+}
+
+static bool isDecoderMatched(unsigned int wpm, unsigned int keyerWpm)
+{
+    double ratio = (double)keyerWpm / wpm;
+    
+    return (ratio > DECODER_MIN_RATIO) && (ratio < DECODER_MAX_RATIO);
+}
+
+// Boot the firmware, key the corpus and collect the echoed characters. Runs in a 
+// forked process because the firmware state can not be reset.
+static BenchResult runBenchmark(const std::string &corpus, unsigned int wpm, const FistModel &fist, unsigned int seed, 
+    int *settings, bool verbose)
+{
+    std::mt19937 random(seed);
+    std::vector<KeyEvent> events;
+    std::string decoded, reference;
+    BenchResult result;
+    unsigned long bootInterrupts;
+    unsigned long long bootInterruptTime, bootTaskTime;
+    simTime endTime;
+    size_t eventPos;
+    int speedField = firmwareSettingsField("speed");
+    
+    if(settings[speedField] < 0)
+    {
+        settings[speedField] = matchKeyerSpeed(wpm);
+    }
+    
+    firmwarePresetSettings(settings, firmwareSettingsCount());
+    
+    sim.hostReceive = [&decoded](unsigned char value)
+    {
+        if((value >= ' ') && (value < 0x7F))
+        {
+            decoded += (char)value;
+        }
+    };
+    
+    sim.boot();
+    sim.runUntil(SETTLE_TIME);
+    
+    bootInterrupts = sim.interruptCount;
+    bootInterruptTime = sim.interruptHostTime;
+    bootTaskTime = sim.taskHostTime;
+    
+    endTime = keyCorpus(corpus, wpm, fist, random, sim.now, events) + DECODER_TAIL_TIME;
+    
+    for(eventPos = 0; eventPos < events.size(); eventPos++)
+    {
+        sim.runUntil(events[eventPos].time);
+        sim.setInput(PIN_KEY, events[eventPos].closed);
+    }
+    
+    sim.runUntil(endTime);
+    
+    reference = normalizeText(corpus);
+    decoded = normalizeText(decoded);
+    
+    result.wpm = wpm;
+    result.keyerWpm = 5 * (settings[speedField] + 1);
+    result.characters = reference.size();
+    result.errors = editDistance(reference, decoded);
+    result.decoded = decoded.size();
+    result.interrupts = sim.interruptCount - bootInterrupts;
+    result.interruptHostTime = sim.interruptHostTime - bootInterruptTime;
+    result.taskHostTime = sim.taskHostTime - bootTaskTime;
+    
+    if(verbose)
+    {
+        printf("%3u WPM sent:    %s\n%3u WPM decoded: %s\n", wpm, reference.c_str(), wpm, decoded.c_str());
+        fflush(stdout);
+    }
+    
+    return result;
+}
+
+static bool forkBenchmark(const std::string &corpus, unsigned int wpm, const FistModel &fist, unsigned int seed, 
+    int *settings, bool verbose, BenchResult &result)
+{
+    int resultPipe[2];
+    int status;
+    pid_t child;
+    bool received;
+    
+    if(pipe(resultPipe) != 0)
+    {
+        return false;
+    }
+    
+    // Pending output would be written again by the child.
+    fflush(stdout);
+    
+    child = fork();
+    if(child == 0)
+    {
+        close(resultPipe[0]);
+        result = runBenchmark(corpus, wpm, fist, seed, settings, verbose);
+        _exit((write(resultPipe[1], &result, sizeof(result)) == sizeof(result)) ? 0 : 1);
+    }
+    
+    close(resultPipe[1]);
+    received = (child > 0) && (read(resultPipe[0], &result, sizeof(result)) == sizeof(result));
+    close(resultPipe[0]);
+    
+    if(child > 0)
+    {
+        waitpid(child, &status, 0);
+    }
+    
+    return received;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int minWpm = 3, maxWpm = 9, stepWpm = 3;
+    unsigned int characters = DEFAULT_CHARACTERS;
+    unsigned int seed = 1;
+    FistModel fist = {0.0, 0.0, 0.0};
+    int settings[MAX_SETTINGS];
+    bool verbose = false;
+    bool mismatched = false;
+    BenchResult result, total;
+    std::string corpus;
+    char *valueText;
+    int option, field;
+    unsigned int wpm;
+    
+    for(field = 0; field < MAX_SETTINGS; field++)
+    {
+        settings[field] = -1;
+    }
+    
+    // Straight key in the keyer mode. Decoded characters are echoed to the host.
+    settings[firmwareSettingsField("input")] = 1;
+    settings[firmwareSettingsField("keyer")] = 0;
+    
+    while((option = getopt(argc, argv, "w:n:j:g:c:r:s:vh")) != -1)
+    {
+        switch(option)
+        {
+            case 'w':
+                if(sscanf(optarg, "%u:%u:%u", &minWpm, &maxWpm, &stepWpm) < 2)
+                {
+                    maxWpm = minWpm;
+                }
+                break;
+            case 'n':
+                characters = strtoul(optarg, NULL, 10);
+                break;
+            case 'j':
+                fist.jitter = atof(optarg);
+                break;
+            case 'g':
+                fist.weight = atof(optarg);
+                break;
+            case 'c':
+                fist.bounce = atof(optarg);
+                break;
+            case 'r':
+                seed = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                valueText = strchr(optarg, '=');
+                if(valueText == NULL)
+                {
+                    printUsage(argv[0]);
+                    return 1;
+                }
+                
+                *valueText++ = '\0';
+                field = ((optarg[0] >= '0') && (optarg[0] <= '9')) ? atoi(optarg) : firmwareSettingsField(optarg);
+                
+                if((field < 0) || (field >= firmwareSettingsCount()))
+                {
+                    fprintf(stderr, "Unknown setting: %s\n", optarg);
+                    return 1;
+                }
+                
+                settings[field] = atoi(valueText);
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                printUsage(argv[0]);
+                return (option == 'h') ? 0 : 1;
+        }
+    }
+    
+    if((minWpm == 0) || (maxWpm < minWpm) || (stepWpm == 0) || (characters == 0))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    memset(&total, 0, sizeof(total));
+    
+    printf("Jitter %.1f%%, weight %+.1f%%, bounce %.1fms, %u characters per speed, seed %u\n\n", 
+        fist.jitter, fist.weight, fist.bounce, characters, seed);
+    printf("  WPM  Keyer   Chars  Errors     CER  ISR/char  Host ns/char\n");
+    
+    for(wpm = minWpm; wpm <= maxWpm; wpm += stepWpm)
+    {
+        // Every speed gets a new corpus from the same seed.
+        std::mt19937 random(seed + wpm);
+        corpus = makeCorpus(random, characters);
+        
+        if(!forkBenchmark(corpus, wpm, fist, seed + wpm, settings, verbose, result))
+        {
+            fprintf(stderr, "Benchmark of %u WPM failed\n", wpm);
+            return 1;
+        }
+        
+        printf("%5u  %5u  %6u  %6u  %5.1f%%  %8.1f  %12.0f%s\n", result.wpm, result.keyerWpm, result.characters, result.errors, 
+            (100.0 * result.errors) / result.characters, (double)result.interrupts / std::max(1U, result.decoded), 
+            (double)(result.interruptHostTime + result.taskHostTime) / std::max(1U, result.decoded), 
+            isDecoderMatched(result.wpm, result.keyerWpm) ? "" : "  *");
+        
+        mismatched |= !isDecoderMatched(result.wpm, result.keyerWpm);
+        
+        total.characters += result.characters;
+        total.errors += result.errors;
+        total.decoded += result.decoded;
+        total.interrupts += result.interrupts;
+        total.interruptHostTime += result.interruptHostTime;
+        total.taskHostTime += result.taskHostTime;
+    }
+    
+    printf("Total         %6u  %6u  %5.1f%%  %8.1f  %12.0f\n", total.characters, total.errors, 
+        (100.0 * total.errors) / total.characters, (double)total.interrupts / std::max(1U, total.decoded), 
+        (double)(total.interruptHostTime + total.taskHostTime) / std::max(1U, total.decoded));
+    
+    if(mismatched)
+    {
+        printf("\n* Sender timing is out of the decoder thresholds, the keyer speed must be %.2f to %.2f\n"
+            "  times the sender speed.\n", DECODER_MIN_RATIO, DECODER_MAX_RATIO);
+    }
+    
+    return 0;
+}
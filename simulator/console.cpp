@@ -0,0 +1,133 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "console.h"
+#include "lcd.h"
+
+EventLog::EventLog()
+{
+    file = NULL;
+    lcdPending = false;
+    pttActive = false;
+    toneActive = false;
+}
+
+EventLog::~EventLog()
+{
+    close();
+}
+
+bool EventLog::open(const char *fileName)
+{
+    file = (strcmp(fileName, "-") == 0) ? stdout : fopen(fileName, "w");
+    return file != NULL;
+}
+
+void EventLog::close()
+{
+    if(file == NULL)
+    {
+        return;
+    }
+    
+    flush();
+    
+    if(file != stdout)
+    {
+        fclose(file);
+    }
+    
+    file = NULL;
+}
+
+void EventLog::writeEvent(const char *format, ...)
+{
+    va_list args;
+    
+    if(file == NULL)
+    {
+        return;
+    }
+    
+    fprintf(file, "%10.3f  ", (double)sim.now / SIM_MS / 1000.0);
+    
+    va_start(args, format);
+    vfprintf(file, format, args);
+    va_end(args);
+    
+    fputc('\n', file);
+    fflush(file);
+}
+
+void EventLog::flush()
+{
+    std::string rows;
+    
+    if(!lcdPending)
+    {
+        return;
+    }
+    
+    lcdPending = false;
+    rows = "|" + sim.lcd->row(0) + "|" + sim.lcd->row(1) + "|";
+    
+    if(rows != lcdRows)
+    {
+        lcdRows = rows;
+        writeEvent("LCD %s", rows.c_str());
+    }
+}
+
+void EventLog::portChanged(char port, unsigned char value)
+{
+    if((port == 'C') && (((value & PIN_PTT) != 0) != pttActive))
+    {
+        pttActive = !pttActive;
+        writeEvent("PTT %s", pttActive ? "on" : "off");
+    }
+}
+
+void EventLog::toneChanged(bool active, unsigned char duty, unsigned long frequency)
+{
+    // Sidetone follows the keying output.
+    if(active != toneActive)
+    {
+        toneActive = active;
+        
+        if(active)
+        {
+            writeEvent("KEY down %luHz", frequency);
+        }
+        else
+        {
+            writeEvent("KEY up");
+        }
+    }
+}
+
+void EventLog::lcdChanged(const LcdModel &lcd)
+{
+    lcdPending = true;
+}
@@ -0,0 +1,61 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef SIM_CONSOLE_H
+#define	SIM_CONSOLE_H
+
+#include <stdio.h>
+
+#include <string>
+
+#include "hardware.h"
+
+// Text log of the keying output, PTT output and display content with the 
+// virtual time stamps.
+class EventLog : public SimObserver
+{
+public:
+    EventLog();
+    ~EventLog();
+    
+    bool open(const char *fileName);
+    void close();
+    
+    // Display content is written once per call, after the firmware has finished 
+    // the screen update.
+    void flush();
+    
+    void portChanged(char port, unsigned char value) override;
+    void toneChanged(bool active, unsigned char duty, unsigned long frequency) override;
+    void lcdChanged(const LcdModel &lcd) override;
+    
+private:
+    void writeEvent(const char *format, ...);
+    
+    FILE *file;
+    bool lcdPending;
+    std::string lcdRows;
+    bool pttActive;
+    bool toneActive;
+};
+
+#endif	/* SIM_CONSOLE_H */
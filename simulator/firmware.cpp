@@ -0,0 +1,236 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+// Host build of the firmware. All firmware modules are compiled as a single 
+// translation unit, so the globals defined in the firmware headers are defined 
+// only once. Firmware main() is replaced by the simulator loop.
+
+#include <string.h>
+#include <algorithm>
+
+#include "hardware.h"
+#include "firmware.h"
+
+#define main firmwareMain
+
+// Instrumented build counts only the real calls of the firmware. Inline functions 
+// take no hardware stack level on the PIC.
+#ifdef STACK_DEBUG
+#define inline inline __attribute__((no_instrument_function))
+#endif
+
+#include "../firmware/main.c"
+#include "../firmware/lcd1602.c"
+#include "../firmware/uart.c"
+#include "../firmware/pwm.c"
+#include "../firmware/ringbuffer.c"
+#include "../firmware/morse.c"
+#include "../firmware/mem_manager.c"
+#include "../firmware/scheduler.c"
+#include "../firmware/clock.c"
+#include "../firmware/diag.c"
+#include "../firmware/winkey.c"
+#include "../firmware/trace.c"
+
+#undef main
+#undef inline
+
+#ifdef STACK_DEBUG
+
+// Hardware stack model of the instrumented build. Each firmware call takes a 
+// level and the interrupt takes a level on top of the interrupted code. Main code 
+// can be interrupted anywhere, so the worst case is the sum of the deepest chains.
+static unsigned char callDepth = 0;
+static unsigned char interruptBase = 0;
+static bool inInterrupt = false;
+static unsigned char mainPeak = 0;
+static unsigned char interruptPeak = 0;
+
+extern "C" void __cyg_profile_func_enter(void *function, void *callSite)
+{
+    (void)callSite;
+    
+    if(function == reinterpret_cast<void *>(systemISR))
+    {
+        inInterrupt = true;
+        interruptBase = callDepth;
+    }
+    
+    callDepth++;
+    
+    if(inInterrupt)
+    {
+        interruptPeak = std::max<unsigned char>(interruptPeak, callDepth - interruptBase);
+    }
+    else
+    {
+        mainPeak = std::max(mainPeak, callDepth);
+    }
+    
+    stackPeak = mainPeak + interruptPeak;
+}
+
+extern "C" void __cyg_profile_func_exit(void *function, void *callSite)
+{
+    (void)callSite;
+    
+    callDepth--;
+    
+    if(function == reinterpret_cast<void *>(systemISR))
+    {
+        inInterrupt = false;
+    }
+}
+
+#endif
+
+void firmwareStart()
+{
+    startSystem();
+}
+
+// Run the next ready task of the main loop. Returns the task identifier or zero 
+// if the main loop is idle.
+unsigned char firmwareRunTask()
+{
+    unsigned char taskMask = 0x01;
+    
+    if(taskReady == 0)
+    {
+        return 0;
+    }
+    
+    // Task selected by runNextTask is the lowest ready bit.
+    while((taskReady & taskMask) == 0)
+    {
+        taskMask <<= 1;
+    }
+    
+    runNextTask();
+    return taskMask;
+}
+
+void firmwareInterrupt()
+{
+    systemISR();
+}
+
+// Last character written into the typeahead buffer.
+static unsigned char lastQueuedChar()
+{
+    unsigned char bufferPos = (dataBuffer.writePos != 0) ? (dataBuffer.writePos - 1) : (dataBuffer.size - 1);
+    
+    if(bufferPos < RING_BUFFER_SIZE)
+    {
+        return dataBuffer.morseBuffer[bufferPos];
+    }
+    
+    return arena.typeahead.queue[bufferPos - RING_BUFFER_SIZE];
+}
+
+void firmwareProbe(FirmwareProbe *probe)
+{
+    unsigned char pattern;
+    
+    probe->queueDepth = getBufferCount(&dataBuffer);
+    probe->queueSize = dataBuffer.size;
+    probe->morseElements = 0;
+    for(pattern = decodePattern; pattern > DECODE_EMPTY; pattern >>= 1)
+    {
+        probe->morseElements++;
+    }
+    
+    probe->keyState = keyFiltered;
+    probe->txPattern = txPattern;
+    probe->txKeyed = txKeyed;
+    probe->pttState = pttState;
+    probe->clockMode = clockMode;
+    probe->uiScreen = uiScreen;
+    probe->taskReady = taskReady;
+    probe->operatingMode = operatingMode;
+    probe->speed = (keyTiming.unitTicks != 0) ? (120 / keyTiming.unitTicks) : 0;
+    probe->lastQueued = lastQueuedChar();
+}
+
+void firmwarePresetSettings(const int *fieldValues, unsigned char fieldCount)
+{
+    unsigned char fieldPos;
+    
+    loadSystemSettings(systemConfig);
+    
+    // Negative value keeps the stored setting.
+    for(fieldPos = 0; (fieldPos < fieldCount) && (fieldPos < SETTINGS_FIELDS); fieldPos++)
+    {
+        if(fieldValues[fieldPos] >= 0)
+        {
+            systemConfig[fieldPos] = (unsigned char)fieldValues[fieldPos];
+        }
+    }
+    
+    // Record is written straight into the E2PROM image without the write time.
+    saveSystemSettings(systemConfig);
+    
+    while(memJobCount > 0)
+    {
+        sim.eeprom[memJobAddr++] = *memJobData++;
+        memJobCount--;
+    }
+}
+
+unsigned char firmwareSettingsCount()
+{
+    return SETTINGS_FIELDS;
+}
+
+// Settings field of the given name (or number) for the command line options.
+int firmwareSettingsField(const char *name)
+{
+    static const struct
+    {
+        const char *name;
+        unsigned char field;
+    } fieldNames[] = 
+    {
+        {"input", OPT_INPUT_MODE},
+        {"keyer", OPT_KEYER_TYPE},
+        {"speed", OPT_SPEED},
+        {"speaker", OPT_SPEAKER_OUT},
+        {"loop", OPT_LOOP_SEND},
+        {"keying", OPT_TONE_TYPE},
+        {"filter", OPT_KEY_FILTER},
+        {"ptt", OPT_PTT_TIMING},
+        {"pitch", OPT_TONE_FREQ},
+        {"record", OPT_REC_MODE},
+        {"baud", OPT_BAUD_RATE}
+    };
+    unsigned char namePos;
+    
+    for(namePos = 0; namePos < (sizeof(fieldNames) / sizeof(fieldNames[0])); namePos++)
+    {
+        if(strcmp(name, fieldNames[namePos].name) == 0)
+        {
+            return fieldNames[namePos].field;
+        }
+    }
+    
+    return -1;
+}
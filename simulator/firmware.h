@@ -0,0 +1,57 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef SIM_FIRMWARE_H
+#define	SIM_FIRMWARE_H
+
+// Interface to the firmware which is compiled into the simulator. Firmware 
+// globals are not visible outside firmware.cpp.
+
+// Snapshot of the firmware state for the traces.
+struct FirmwareProbe
+{
+    unsigned char queueDepth;       // Characters in the typeahead buffer.
+    unsigned char queueSize;
+    unsigned char morseElements;    // Elements in the pattern of the decoder.
+    unsigned char keyState;         // Key inputs after the glitch filter.
+    unsigned char txPattern;        // Pending elements of the transmit engine.
+    unsigned char txKeyed;
+    unsigned char pttState;
+    unsigned char clockMode;
+    unsigned char uiScreen;
+    unsigned char taskReady;
+    unsigned char operatingMode;
+    unsigned char speed;            // Keying speed in WPM.
+    unsigned char lastQueued;       // Last character written into the typeahead buffer.
+};
+
+void firmwareStart(void);
+unsigned char firmwareRunTask(void);
+void firmwareInterrupt(void);
+void firmwareProbe(FirmwareProbe *probe);
+
+// Write settings fields into the E2PROM record before the firmware is started.
+void firmwarePresetSettings(const int *fieldValues, unsigned char fieldCount);
+unsigned char firmwareSettingsCount(void);
+int firmwareSettingsField(const char *name);
+
+#endif	/* SIM_FIRMWARE_H */
@@ -0,0 +1,812 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <string.h>
+
+#include <chrono>
+
+#include "hardware.h"
+#include "firmware.h"
+#include "lcd.h"
+
+// Special function registers with their power-on reset values and read-only bits.
+Register PORTA("PORTA", 0x00), PORTB("PORTB", 0x00), PORTC("PORTC", 0x00);
+Register TRISA("TRISA", 0xFF), TRISB("TRISB", 0xFF), TRISC("TRISC", 0xFF), WPUB("WPUB", 0xFF);
+Register INTCON("INTCON", 0x00), PIE1("PIE1", 0x00), PIR1("PIR1", 0x00, 0x30);
+Register OPTION_REG("OPTION_REG", 0xFF), OSCCON("OSCCON", 0x68);
+Register TMR0("TMR0", 0x00), TMR1L("TMR1L", 0x00), TMR1H("TMR1H", 0x00), T1CON("T1CON", 0x00);
+Register TMR2("TMR2", 0x00), T2CON("T2CON", 0x00), PR2("PR2", 0xFF);
+Register CCPR1L("CCPR1L", 0x00), CCP1CON("CCP1CON", 0x00);
+Register RCSTA("RCSTA", 0x00, 0x07), TXSTA("TXSTA", 0x02, 0x02), RCREG("RCREG", 0x00), TXREG("TXREG", 0x00);
+Register SPBRG("SPBRG", 0x00), SPBRGH("SPBRGH", 0x00), BAUDCTL("BAUDCTL", 0x40, 0x40);
+Register ANSEL("ANSEL", 0xFF), ANSELH("ANSELH", 0x3F), ADCON0("ADCON0", 0x00);
+Register CM1CON0("CM1CON0", 0x00), CM2CON0("CM2CON0", 0x00), SSPCON("SSPCON", 0x00), EECON1("EECON1", 0x00);
+
+RegisterBit GIE(INTCON, 0x80), PEIE(INTCON, 0x40), T0IE(INTCON, 0x20), T0IF(INTCON, 0x04);
+RegisterBit RCIF(PIR1, 0x20), TXIF(PIR1, 0x10), TMR2IF(PIR1, 0x02), TMR1IF(PIR1, 0x01);
+RegisterBit RCIE(PIE1, 0x20), TXIE(PIE1, 0x10), TMR2IE(PIE1, 0x02), TMR1IE(PIE1, 0x01);
+RegisterBit RB0(PORTB, 0x01), RB1(PORTB, 0x02), RB2(PORTB, 0x04), RB3(PORTB, 0x08);
+RegisterBit RB4(PORTB, 0x10), RB5(PORTB, 0x20), RB6(PORTB, 0x40), RB7(PORTB, 0x80);
+RegisterBit TRMT(TXSTA, 0x02), RCIDL(BAUDCTL, 0x40), CREN(RCSTA, 0x10), OERR(RCSTA, 0x02), FERR(RCSTA, 0x04), WR(EECON1, 0x02);
+
+static LcdModel lcdController;
+
+Simulator sim;
+
+// Host CPU time in nanoseconds for the firmware cost statistics.
+static unsigned long long hostClock()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Register::Register(const char *regName, unsigned char resetValue, unsigned char readOnlyMask) : 
+    name(regName), value(resetValue), readOnly(readOnlyMask)
+{
+}
+
+Register::operator unsigned char() const
+{
+    return sim.readRegister(*this);
+}
+
+Register &Register::operator=(unsigned char newValue)
+{
+    unsigned char oldValue = value;
+    
+    value = (newValue & ~readOnly) | (oldValue & readOnly);
+    sim.writeRegister(*this, oldValue);
+    return *this;
+}
+
+Register &Register::operator|=(unsigned char mask)
+{
+    return *this = (unsigned char)(*this | mask);
+}
+
+Register &Register::operator&=(unsigned char mask)
+{
+    return *this = (unsigned char)(*this & mask);
+}
+
+Register &Register::operator^=(unsigned char mask)
+{
+    return *this = (unsigned char)(*this ^ mask);
+}
+
+RegisterBit::RegisterBit(Register &owner, unsigned char bitMask) : reg(owner), mask(bitMask)
+{
+}
+
+RegisterBit::operator unsigned char() const
+{
+    return (reg & mask) ? 1 : 0;
+}
+
+RegisterBit &RegisterBit::operator=(unsigned char state)
+{
+    if(state)
+    {
+        reg |= mask;
+    }
+    else
+    {
+        reg &= (unsigned char)~mask;
+    }
+    
+    return *this;
+}
+
+void simDelayCycles(unsigned long long cycles)
+{
+    sim.delayCycles(cycles);
+}
+
+unsigned char eeprom_read(unsigned char addr)
+{
+    return sim.eepromRead(addr);
+}
+
+void eeprom_write(unsigned char addr, unsigned char value)
+{
+    sim.eepromWrite(addr, value);
+}
+
+Simulator::Simulator()
+{
+    now = 0;
+    
+    hostBaud = 0;
+    hostFlowControl = true;
+    hostPaused = false;
+    
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    lcd = &lcdController;
+    
+    interruptCount = 0;
+    taskCount = 0;
+    overrunCount = 0;
+    framingErrorCount = 0;
+    interruptHostTime = 0;
+    taskHostTime = 0;
+    
+    inputPins = 0x7F;
+    inInterrupt = false;
+    
+    timer0Overflow = SIM_NEVER;
+    timer1Overflow = SIM_NEVER;
+    timer2Match = SIM_NEVER;
+    timer2Postscale = 0;
+    
+    txRegFull = false;
+    txRegValue = 0;
+    txShifting = false;
+    txShiftValue = 0;
+    txShiftEnd = SIM_NEVER;
+    
+    rxFifoCount = 0;
+    rxActive = false;
+    rxValue = 0;
+    rxFramingError = false;
+    rxEnd = SIM_NEVER;
+    
+    eepromWriteEnd = SIM_NEVER;
+    
+    lastToneActive = false;
+    lastToneDuty = 0;
+    lastToneFrequency = 0;
+}
+
+void Simulator::boot()
+{
+    // Timer 0 runs from the reset with the default prescaler.
+    timer0Overflow = now + (256 * timer0Tick());
+    
+    firmwareStart();
+    notifyStep(CONTEXT_ISR);
+}
+
+void Simulator::runUntil(simTime endTime)
+{
+    unsigned char taskId;
+    unsigned long long startTime;
+    
+    while(now < endTime)
+    {
+        // Firmware code runs in zero virtual time except the busy wait loops.
+        startTime = hostClock();
+        taskId = firmwareRunTask();
+        taskHostTime += hostClock() - startTime;
+        
+        if(taskId != 0)
+        {
+            taskCount++;
+            notifyStep(taskId);
+            continue;
+        }
+        
+        // Main loop is idle until the next peripheral event.
+        advanceTo((nextEvent() < endTime) ? nextEvent() : endTime);
+    }
+}
+
+void Simulator::setInput(unsigned char pins, bool closed)
+{
+    unsigned char oldPins = inputPins;
+    
+    if(closed)
+    {
+        inputPins &= ~pins;
+    }
+    else
+    {
+        inputPins |= pins;
+    }
+    
+    if(inputPins != oldPins)
+    {
+        for(SimObserver *observer : observers)
+        {
+            observer->portChanged('B', inputPins);
+        }
+    }
+}
+
+void Simulator::sendToKeyer(unsigned char value)
+{
+    rxQueue.push_back(value);
+    
+    if(!rxActive)
+    {
+        startReceive();
+    }
+}
+
+size_t Simulator::pendingToKeyer() const
+{
+    return rxQueue.size() + (rxActive ? 1 : 0);
+}
+
+unsigned long Simulator::oscillator() const
+{
+    // Internal oscillator frequency selected by IRCF bits of OSCCON.
+    static const unsigned long frequency[8] = {31000, 125000, 250000, 500000, 1000000, 2000000, 4000000, 8000000};
+    return frequency[(OSCCON.value >> 4) & 0x07];
+}
+
+unsigned long Simulator::keyerBaud() const
+{
+    unsigned long divider = ((unsigned long)SPBRGH.value << 8) | SPBRG.value;
+    unsigned long scale;
+    
+    // Baud rate formula selected by BRG16 and BRGH.
+    if(BAUDCTL.value & 0x08)
+    {
+        scale = (TXSTA.value & 0x04) ? 4 : 16;
+    }
+    else
+    {
+        scale = (TXSTA.value & 0x04) ? 16 : 64;
+        divider &= 0xFF;
+    }
+    
+    return oscillator() / (scale * (divider + 1));
+}
+
+bool Simulator::toneActive() const
+{
+    return lastToneActive;
+}
+
+unsigned char Simulator::readRegister(const Register &reg)
+{
+    simTime remaining;
+    unsigned long count;
+    
+    if(&reg == &PORTB)
+    {
+        // Input pins are read from the switches, outputs from the latch.
+        return (inputPins & TRISB.value) | (PORTB.value & ~TRISB.value);
+    }
+    
+    if(&reg == &RCREG)
+    {
+        if(rxFifoCount == 0)
+        {
+            return RCREG.value;
+        }
+        
+        RCREG.value = rxFifo[0];
+        rxFifo[0] = rxFifo[1];
+        rxFifoCount--;
+        
+        if(rxFifoCount == 0)
+        {
+            PIR1.value &= ~0x20;
+        }
+        
+        return RCREG.value;
+    }
+    
+    if(((&reg == &TMR1L) || (&reg == &TMR1H)) && (timer1Overflow != SIM_NEVER))
+    {
+        remaining = (timer1Overflow - now + timer1Tick() - 1) / timer1Tick();
+        count = 65536 - (unsigned long)remaining;
+        return (&reg == &TMR1L) ? (count & 0xFF) : ((count >> 8) & 0xFF);
+    }
+    
+    if((&reg == &TMR0) && (timer0Overflow != SIM_NEVER))
+    {
+        remaining = (timer0Overflow - now + timer0Tick() - 1) / timer0Tick();
+        return (256 - remaining) & 0xFF;
+    }
+    
+    return reg.value;
+}
+
+void Simulator::writeRegister(Register &reg, unsigned char oldValue)
+{
+    unsigned char newValue = reg.value;
+    unsigned long count;
+    simTime oldCycle;
+    
+    if(&reg == &PORTA)
+    {
+        if(newValue != oldValue)
+        {
+            for(SimObserver *observer : observers)
+            {
+                observer->portChanged('A', newValue);
+            }
+        }
+        
+        // Display controller latches the bus on the falling edge of E.
+        if((oldValue & 0x08) && !(newValue & 0x08))
+        {
+            if(lcd->clock((newValue & 0x04) ? 1 : 0, newValue >> 4, now))
+            {
+                for(SimObserver *observer : observers)
+                {
+                    observer->lcdChanged(*lcd);
+                }
+            }
+        }
+    }
+    else if(&reg == &PORTC)
+    {
+        if(((newValue ^ oldValue) & ~TRISC.value) != 0)
+        {
+            for(SimObserver *observer : observers)
+            {
+                observer->portChanged('C', newValue & ~TRISC.value);
+            }
+        }
+    }
+    else if(&reg == &TXREG)
+    {
+        txRegValue = newValue;
+        txRegFull = true;
+        PIR1.value &= ~0x10;
+        
+        if(!txShifting)
+        {
+            startTransmit();
+        }
+    }
+    else if(&reg == &TMR0)
+    {
+        timer0Overflow = now + ((256 - newValue) * timer0Tick());
+    }
+    else if((&reg == &TMR1L) || (&reg == &TMR1H) || (&reg == &T1CON))
+    {
+        if(T1CON.value & 0x01)
+        {
+            count = ((unsigned long)TMR1H.value << 8) | TMR1L.value;
+            timer1Overflow = now + ((65536 - count) * timer1Tick());
+        }
+        else
+        {
+            timer1Overflow = SIM_NEVER;
+        }
+    }
+    else if(&reg == &T2CON)
+    {
+        if(!(T2CON.value & 0x04))
+        {
+            timer2Match = SIM_NEVER;
+        }
+        else if(timer2Match == SIM_NEVER)
+        {
+            timer2Match = now + timer2Period();
+        }
+        
+        updateTone();
+    }
+    else if((&reg == &PR2) || (&reg == &CCPR1L) || (&reg == &CCP1CON))
+    {
+        updateTone();
+    }
+    else if(&reg == &OSCCON)
+    {
+        if(((newValue ^ oldValue) & 0x70) != 0)
+        {
+            // Pending timer counts are continued with the new clock.
+            OSCCON.value = oldValue;
+            oldCycle = cycleTime();
+            OSCCON.value = newValue;
+            rescaleTimers(oldCycle);
+            updateTone();
+        }
+    }
+    else if(&reg == &OPTION_REG)
+    {
+        if((((newValue ^ oldValue) & 0x0F) != 0) && (timer0Overflow != SIM_NEVER))
+        {
+            OPTION_REG.value = oldValue;
+            count = (unsigned long)((timer0Overflow - now) / timer0Tick());
+            OPTION_REG.value = newValue;
+            timer0Overflow = now + (count * timer0Tick());
+        }
+    }
+    else if(&reg == &TXSTA)
+    {
+        // TXIF is set while the transmitter is enabled and TXREG is empty.
+        if((newValue & 0x20) && !txRegFull)
+        {
+            PIR1.value |= 0x10;
+        }
+    }
+    else if(&reg == &RCSTA)
+    {
+        // Clearing CREN resets the receive logic and the overrun error.
+        if((newValue & 0x10) == 0)
+        {
+            RCSTA.value &= ~0x02;
+        }
+        else if(((newValue & 0x90) == 0x90) && !rxActive)
+        {
+            startReceive();
+        }
+    }
+    
+    // Enabling an interrupt with a pending flag raises the interrupt at once.
+    if((&reg == &INTCON) || (&reg == &PIE1) || (&reg == &PIR1))
+    {
+        serviceInterrupts();
+    }
+}
+
+void Simulator::delayCycles(unsigned long long cycles)
+{
+    advanceTo(now + (cycles * cycleTime()));
+}
+
+unsigned char Simulator::eepromRead(unsigned char addr)
+{
+    return eeprom[addr];
+}
+
+void Simulator::eepromWrite(unsigned char addr, unsigned char value)
+{
+    // Library routine waits for the previous write cycle.
+    if(eepromWriteEnd != SIM_NEVER)
+    {
+        advanceTo(eepromWriteEnd);
+    }
+    
+    eeprom[addr] = value;
+    EECON1.value |= 0x02;
+    eepromWriteEnd = now + EEPROM_WRITE_TIME;
+}
+
+void Simulator::advanceTo(simTime endTime)
+{
+    simTime eventTime;
+    unsigned char postscale;
+    
+    while(true)
+    {
+        eventTime = nextEvent();
+        
+        if(eventTime > endTime)
+        {
+            now = endTime;
+            return;
+        }
+        
+        now = eventTime;
+        
+        if(timer0Overflow == now)
+        {
+            INTCON.value |= 0x04;
+            timer0Overflow = now + (256 * timer0Tick());
+        }
+        
+        if(timer1Overflow == now)
+        {
+            PIR1.value |= 0x01;
+            TMR1H.value = 0;
+            TMR1L.value = 0;
+            timer1Overflow = now + (65536 * timer1Tick());
+        }
+        
+        if(timer2Match == now)
+        {
+            // TMR2IF is raised after the postscaler count of periods.
+            postscale = ((T2CON.value >> 3) & 0x0F) + 1;
+            if((++timer2Postscale) >= postscale)
+            {
+                timer2Postscale = 0;
+                PIR1.value |= 0x02;
+            }
+            
+            timer2Match = now + timer2Period();
+        }
+        
+        if(txShiftEnd == now)
+        {
+            txShifting = false;
+            txShiftEnd = SIM_NEVER;
+            
+            // XON and XOFF of the keyer control the host sender.
+            if(hostFlowControl && (txShiftValue == 0x13))
+            {
+                hostPaused = true;
+            }
+            else if(txShiftValue == 0x11)
+            {
+                hostPaused = false;
+            }
+            
+            if(hostReceive)
+            {
+                hostReceive(txShiftValue);
+            }
+            
+            if(txRegFull)
+            {
+                startTransmit();
+            }
+            else
+            {
+                TXSTA.value |= 0x02;
+            }
+            
+            if(!rxActive)
+            {
+                startReceive();
+            }
+        }
+        
+        if(rxEnd == now)
+        {
+            rxActive = false;
+            rxEnd = SIM_NEVER;
+            BAUDCTL.value |= 0x40;
+            
+            if(rxFramingError)
+            {
+                framingErrorCount++;
+            }
+            else if((rxFifoCount < 2) && ((RCSTA.value & 0x02) == 0))
+            {
+                rxFifo[rxFifoCount++] = rxValue;
+                PIR1.value |= 0x20;
+            }
+            else
+            {
+                // Receive FIFO is full, or the receiver is stopped by an overrun 
+                // until CREN is cleared, and the byte is lost.
+                RCSTA.value |= 0x02;
+                overrunCount++;
+            }
+            
+            startReceive();
+        }
+        
+        if(eepromWriteEnd == now)
+        {
+            EECON1.value &= ~0x02;
+            eepromWriteEnd = SIM_NEVER;
+        }
+        
+        serviceInterrupts();
+    }
+}
+
+simTime Simulator::nextEvent() const
+{
+    simTime eventTime = timer0Overflow;
+    
+    if(timer1Overflow < eventTime)
+    {
+        eventTime = timer1Overflow;
+    }
+    
+    if(timer2Match < eventTime)
+    {
+        eventTime = timer2Match;
+    }
+    
+    if(txShiftEnd < eventTime)
+    {
+        eventTime = txShiftEnd;
+    }
+    
+    if(rxEnd < eventTime)
+    {
+        eventTime = rxEnd;
+    }
+    
+    if(eepromWriteEnd < eventTime)
+    {
+        eventTime = eepromWriteEnd;
+    }
+    
+    return eventTime;
+}
+
+void Simulator::serviceInterrupts()
+{
+    unsigned char pending;
+    unsigned char guard = 0;
+    unsigned long long startTime;
+    
+    if(inInterrupt)
+    {
+        return;
+    }
+    
+    while(INTCON.value & 0x80)
+    {
+        pending = ((INTCON.value & 0x20) && (INTCON.value & 0x04)) || 
+            ((INTCON.value & 0x40) && ((PIE1.value & PIR1.value) != 0));
+        
+        if(!pending)
+        {
+            break;
+        }
+        
+        // Firmware ISR must clear the flags. Pending flag which is not served is 
+        // held for the next event.
+        if((++guard) > 8)
+        {
+            break;
+        }
+        
+        // Hardware clears GIE on entry and RETFIE sets it again.
+        inInterrupt = true;
+        INTCON.value &= ~0x80;
+        startTime = hostClock();
+        firmwareInterrupt();
+        interruptHostTime += hostClock() - startTime;
+        INTCON.value |= 0x80;
+        inInterrupt = false;
+        
+        interruptCount++;
+        notifyStep(CONTEXT_ISR);
+    }
+}
+
+void Simulator::notifyStep(unsigned char context)
+{
+    FirmwareProbe probe;
+    
+    if(observers.empty())
+    {
+        return;
+    }
+    
+    firmwareProbe(&probe);
+    
+    for(SimObserver *observer : observers)
+    {
+        observer->firmwareStep(context, probe);
+    }
+}
+
+simTime Simulator::cycleTime() const
+{
+    return 4000000000ULL / oscillator();
+}
+
+simTime Simulator::timer0Tick() const
+{
+    // Prescaler is assigned to Timer 0 if PSA is cleared.
+    if(OPTION_REG.value & 0x08)
+    {
+        return cycleTime();
+    }
+    
+    return cycleTime() << ((OPTION_REG.value & 0x07) + 1);
+}
+
+simTime Simulator::timer1Tick() const
+{
+    return cycleTime() << ((T1CON.value >> 4) & 0x03);
+}
+
+simTime Simulator::timer2Period() const
+{
+    static const unsigned char prescale[4] = {1, 4, 16, 16};
+    return cycleTime() * prescale[T2CON.value & 0x03] * ((simTime)PR2.value + 1);
+}
+
+simTime Simulator::bitTime(unsigned long baud) const
+{
+    return 1000000000ULL / baud;
+}
+
+void Simulator::rescaleTimers(simTime oldCycle)
+{
+    simTime newCycle = cycleTime();
+    
+    if(timer0Overflow != SIM_NEVER)
+    {
+        timer0Overflow = now + (((timer0Overflow - now) * newCycle) / oldCycle);
+    }
+    
+    if(timer1Overflow != SIM_NEVER)
+    {
+        timer1Overflow = now + (((timer1Overflow - now) * newCycle) / oldCycle);
+    }
+    
+    if(timer2Match != SIM_NEVER)
+    {
+        timer2Match = now + (((timer2Match - now) * newCycle) / oldCycle);
+    }
+}
+
+void Simulator::startTransmit()
+{
+    // Byte is moved from TXREG into the shift register and TXIF is set again.
+    txShiftValue = txRegValue;
+    txRegFull = false;
+    txShifting = true;
+    txShiftEnd = now + (10 * bitTime(keyerBaud()));
+    
+    PIR1.value |= 0x10;
+    TXSTA.value &= ~0x02;
+    
+    for(SimObserver *observer : observers)
+    {
+        observer->uartByte(true, txShiftValue, now, bitTime(keyerBaud()), false);
+    }
+}
+
+void Simulator::startReceive()
+{
+    unsigned long lineBaud, rxBaud;
+    
+    // Receiver must be enabled (SPEN and CREN) before the host is served.
+    if(rxQueue.empty() || ((RCSTA.value & 0x90) != 0x90) || (hostFlowControl && hostPaused))
+    {
+        return;
+    }
+    
+    rxBaud = keyerBaud();
+    lineBaud = (hostBaud != 0) ? hostBaud : rxBaud;
+    
+    rxValue = rxQueue.front();
+    rxQueue.pop_front();
+    rxActive = true;
+    rxEnd = now + (10 * bitTime(lineBaud));
+    
+    // Receiver samples the stop bit at the wrong time with more than 3% error.
+    rxFramingError = ((lineBaud > rxBaud) ? (lineBaud - rxBaud) : (rxBaud - lineBaud)) * 100 > (rxBaud * 3);
+    
+    BAUDCTL.value &= ~0x40;
+    
+    for(SimObserver *observer : observers)
+    {
+        observer->uartByte(false, rxValue, now, bitTime(lineBaud), rxFramingError);
+    }
+}
+
+void Simulator::updateTone()
+{
+    bool active;
+    unsigned char duty;
+    unsigned long frequency = 0;
+    
+    // CCP1 drives the speaker in PWM mode while Timer 2 is running.
+    active = ((CCP1CON.value & 0x0C) == 0x0C) && (T2CON.value & 0x04) && (CCPR1L.value != 0);
+    duty = ((CCP1CON.value & 0x0C) == 0x0C) ? CCPR1L.value : 0;
+    
+    if(T2CON.value & 0x04)
+    {
+        frequency = (unsigned long)(1000000000ULL / timer2Period());
+    }
+    
+    if((active == lastToneActive) && (duty == lastToneDuty) && (frequency == lastToneFrequency))
+    {
+        return;
+    }
+    
+    lastToneActive = active;
+    lastToneDuty = duty;
+    lastToneFrequency = frequency;
+    
+    for(SimObserver *observer : observers)
+    {
+        observer->toneChanged(active, duty, frequency);
+    }
+}
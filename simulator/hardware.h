@@ -0,0 +1,177 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef SIM_HARDWARE_H
+#define	SIM_HARDWARE_H
+
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "xc.h"
+
+// Virtual time in nanoseconds.
+typedef uint64_t simTime;
+
+#define SIM_US      1000ULL
+#define SIM_MS      1000000ULL
+#define SIM_NEVER   UINT64_MAX
+
+// PORTB inputs. All inputs are active low with the weak pull-ups.
+#define PIN_ENCODER_A   0x01
+#define PIN_ENCODER_B   0x02
+#define PIN_ENCODER_SW  0x04
+#define PIN_KEY         0x08    // Straight key or dit paddle.
+#define PIN_DAH         0x10
+#define PIN_PTT_SW      0x20
+#define PIN_MEM_SW      0x40
+
+// PORTC outputs.
+#define PIN_PTT         0x08
+#define PIN_MUTE        0x10
+#define PIN_BACKLIGHT   0x20
+
+// Firmware execution contexts reported to the observers.
+#define CONTEXT_ISR     0x00
+
+#define EEPROM_SIZE         256
+#define EEPROM_WRITE_TIME   (5 * SIM_MS)
+
+class LcdModel;
+struct FirmwareProbe;
+
+// Receives the pin, peripheral and firmware activity of the simulator.
+class SimObserver
+{
+public:
+    virtual ~SimObserver() {}
+    
+    virtual void portChanged(char port, unsigned char value) {}
+    virtual void toneChanged(bool active, unsigned char duty, unsigned long frequency) {}
+    virtual void uartByte(bool fromKeyer, unsigned char value, simTime start, simTime bitTime, bool framingError) {}
+    virtual void lcdChanged(const LcdModel &lcd) {}
+    virtual void firmwareStep(unsigned char context, const FirmwareProbe &probe) {}
+};
+
+class Simulator
+{
+public:
+    Simulator();
+    
+    // Start the firmware and run it until the given virtual time.
+    void boot();
+    void runUntil(simTime endTime);
+    
+    // Stimulus from the operator and the host.
+    void setInput(unsigned char pins, bool closed);
+    void sendToKeyer(unsigned char value);
+    size_t pendingToKeyer() const;
+    
+    unsigned long oscillator() const;
+    unsigned long keyerBaud() const;
+    bool toneActive() const;
+    
+    // Register access hooks used by the register model.
+    unsigned char readRegister(const Register &reg);
+    void writeRegister(Register &reg, unsigned char oldValue);
+    void delayCycles(unsigned long long cycles);
+    
+    unsigned char eepromRead(unsigned char addr);
+    void eepromWrite(unsigned char addr, unsigned char value);
+    
+    simTime now;
+    
+    // Host side of the serial link. Zero baud rate follows the keyer, otherwise 
+    // bytes with more than 3% baud rate error are lost with a framing error. 
+    // Host flow control stops sending on XOFF from the keyer.
+    unsigned long hostBaud;
+    bool hostFlowControl;
+    bool hostPaused;
+    std::function<void(unsigned char)> hostReceive;
+    
+    unsigned char eeprom[EEPROM_SIZE];
+    LcdModel *lcd;
+    std::vector<SimObserver *> observers;
+    
+    // Statistics.
+    unsigned long interruptCount;
+    unsigned long taskCount;
+    unsigned long overrunCount;
+    unsigned long framingErrorCount;
+    
+    // Host CPU time spent in the firmware ISR and the main loop tasks, in 
+    // nanoseconds. PIC instruction cycles are not modelled.
+    unsigned long long interruptHostTime;
+    unsigned long long taskHostTime;
+    
+private:
+    void advanceTo(simTime endTime);
+    simTime nextEvent() const;
+    void serviceInterrupts();
+    void notifyStep(unsigned char context);
+    
+    simTime cycleTime() const;
+    simTime timer0Tick() const;
+    simTime timer1Tick() const;
+    simTime timer2Period() const;
+    simTime bitTime(unsigned long baud) const;
+    
+    void rescaleTimers(simTime oldCycle);
+    void startTransmit();
+    void startReceive();
+    void updateTone();
+    
+    unsigned char inputPins;
+    bool inInterrupt;
+    
+    simTime timer0Overflow;
+    simTime timer1Overflow;
+    simTime timer2Match;
+    unsigned char timer2Postscale;
+    
+    // UART transmitter (TXREG and shift register) and receiver (2 byte FIFO).
+    bool txRegFull;
+    unsigned char txRegValue;
+    bool txShifting;
+    unsigned char txShiftValue;
+    simTime txShiftEnd;
+    
+    std::deque<unsigned char> rxQueue;
+    unsigned char rxFifo[2];
+    unsigned char rxFifoCount;
+    bool rxActive;
+    unsigned char rxValue;
+    bool rxFramingError;
+    simTime rxEnd;
+    
+    simTime eepromWriteEnd;
+    
+    bool lastToneActive;
+    unsigned char lastToneDuty;
+    unsigned long lastToneFrequency;
+};
+
+extern Simulator sim;
+
+#endif	/* SIM_HARDWARE_H */
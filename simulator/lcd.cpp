@@ -0,0 +1,222 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <cstring>
+
+#include "lcd.h"
+
+LcdModel::LcdModel()
+{
+    reset();
+}
+
+void LcdModel::reset()
+{
+    memset(ddram, ' ', sizeof(ddram));
+    memset(cgram, 0, sizeof(cgram));
+    
+    address = 0;
+    cgramSelected = false;
+    fourBitMode = false;
+    lowNibblePending = false;
+    highNibble = 0;
+    displayOn = false;
+    increment = true;
+    
+    commandCount = 0;
+    dataCount = 0;
+    busyViolations = 0;
+    busyUntil = 0;
+}
+
+bool LcdModel::clock(unsigned char rs, unsigned char nibble, simTime now)
+{
+    // In 8-bit mode only D7..D4 are connected, so each transfer is an 
+    // instruction with the lower 4 bits cleared.
+    if(!fourBitMode)
+    {
+        return execute(rs, nibble << 4, now);
+    }
+    
+    if(!lowNibblePending)
+    {
+        highNibble = nibble;
+        lowNibblePending = true;
+        return false;
+    }
+    
+    lowNibblePending = false;
+    return execute(rs, (highNibble << 4) | nibble, now);
+}
+
+std::string LcdModel::row(unsigned char index) const
+{
+    std::string text;
+    unsigned char col, code;
+    
+    for(col = 0; col < LCD_COLUMNS; col++)
+    {
+        code = ddram[(index ? 0x40 : 0x00) + col];
+        
+        if(!displayOn)
+        {
+            code = ' ';
+        }
+        else if(code < 0x08)
+        {
+            // Custom CGRAM glyph.
+            code = '*';
+        }
+        else if(code == 0x7E)
+        {
+            code = '>';
+        }
+        else if(code == 0xFF)
+        {
+            code = '#';
+        }
+        else if((code < 0x20) || (code > 0x7D))
+        {
+            code = '?';
+        }
+        
+        text += (char)code;
+    }
+    
+    return text;
+}
+
+bool LcdModel::execute(unsigned char rs, unsigned char value, simTime now)
+{
+    bool changed = false;
+    
+    if(now < busyUntil)
+    {
+        busyViolations++;
+    }
+    
+    busyUntil = now + LCD_COMMAND_TIME;
+    
+    if(rs)
+    {
+        // Data write into the selected RAM.
+        dataCount++;
+        
+        if(cgramSelected)
+        {
+            cgram[address & 0x3F] = value;
+            address = (address + 1) & 0x3F;
+            return displayOn;
+        }
+        
+        changed = (ddram[address] != value) && displayOn;
+        ddram[address] = value;
+        advanceAddress();
+        return changed;
+    }
+    
+    commandCount++;
+    
+    if(value & 0x80)
+    {
+        // Set DDRAM address.
+        address = value & 0x7F;
+        cgramSelected = false;
+    }
+    else if(value & 0x40)
+    {
+        // Set CGRAM address.
+        address = value & 0x3F;
+        cgramSelected = true;
+    }
+    else if(value & 0x20)
+    {
+        // Function set: DL selects the interface width.
+        fourBitMode = (value & 0x10) == 0;
+        lowNibblePending = false;
+    }
+    else if(value & 0x08)
+    {
+        // Display on / off control.
+        changed = displayOn != ((value & 0x04) != 0);
+        displayOn = (value & 0x04) != 0;
+    }
+    else if(value & 0x04)
+    {
+        // Entry mode set.
+        increment = (value & 0x02) != 0;
+    }
+    else if(value & 0x02)
+    {
+        // Return home.
+        address = 0;
+        cgramSelected = false;
+        busyUntil = now + LCD_CLEAR_TIME;
+    }
+    else if(value & 0x01)
+    {
+        // Clear display.
+        memset(ddram, ' ', sizeof(ddram));
+        address = 0;
+        cgramSelected = false;
+        increment = true;
+        busyUntil = now + LCD_CLEAR_TIME;
+        changed = displayOn;
+    }
+    
+    return changed;
+}
+
+void LcdModel::advanceAddress()
+{
+    // Two line mode: 0x00 - 0x27 on the first line and 0x40 - 0x67 on the second.
+    if(increment)
+    {
+        if(address == 0x27)
+        {
+            address = 0x40;
+        }
+        else if(address == 0x67)
+        {
+            address = 0x00;
+        }
+        else
+        {
+            address++;
+        }
+    }
+    else
+    {
+        if(address == 0x00)
+        {
+            address = 0x67;
+        }
+        else if(address == 0x40)
+        {
+            address = 0x27;
+        }
+        else
+        {
+            address--;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef SIM_LCD_H
+#define	SIM_LCD_H
+
+#include <string>
+
+#include "hardware.h"
+
+#define LCD_COLUMNS     16
+#define LCD_ROWS        2
+
+// HD44780 execution times of the clear / home commands and other instructions.
+#define LCD_CLEAR_TIME      (1520 * SIM_US)
+#define LCD_COMMAND_TIME    (37 * SIM_US)
+
+// HD44780 controller model driven by the 4-bit bus of PORTA (D7..D4 on RA7..RA4, 
+// E on RA3 and RS on RA2). Controller starts in 8-bit mode as after power-up.
+class LcdModel
+{
+public:
+    LcdModel();
+    
+    void reset();
+    
+    // Latch the bus on the falling edge of E. Returns true if the visible 
+    // content of the display is changed.
+    bool clock(unsigned char rs, unsigned char nibble, simTime now);
+    
+    std::string row(unsigned char index) const;
+    
+    unsigned char ddram[0x80];
+    unsigned char cgram[0x40];
+    unsigned char address;
+    bool cgramSelected;
+    bool fourBitMode;
+    bool lowNibblePending;
+    unsigned char highNibble;
+    bool displayOn;
+    bool increment;
+    
+    // Bus statistics: instructions, data writes and writes issued while the 
+    // controller is still busy with the last instruction.
+    unsigned long commandCount;
+    unsigned long dataCount;
+    unsigned long busyViolations;
+    simTime busyUntil;
+    
+private:
+    bool execute(unsigned char rs, unsigned char value, simTime now);
+    void advanceAddress();
+};
+
+#endif	/* SIM_LCD_H */
@@ -0,0 +1,505 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+// Command line front end of the keyer simulator.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "hardware.h"
+#include "firmware.h"
+#include "lcd.h"
+#include "vcd.h"
+#include "pty.h"
+#include "console.h"
+
+#define DEFAULT_RUN_TIME    5000
+#define MAX_SETTINGS        32
+
+// Virtual time between the terminal, wall clock and log updates.
+#define UPDATE_SLICE        SIM_MS
+
+static volatile sig_atomic_t stopRequest = 0;
+
+// Key and button action of the key script.
+struct KeyEvent
+{
+    simTime time;
+    unsigned char pins;
+    bool closed;
+};
+
+static void printUsage(const char *name)
+{
+    fprintf(stderr, 
+        "Usage: %s [options]\n"
+        "  -t ms          Virtual run time in milliseconds (default %d, no limit with -p).\n"
+        "  -v file        Write VCD trace of the pins and the firmware state.\n"
+        "  -e file        E2PROM image, loaded at start and saved at exit.\n"
+        "  -s name=value  Preset a setting before the boot (input, keyer, speed, speaker,\n"
+        "                 loop, keying, filter, ptt, pitch, record, baud or field number).\n"
+        "  -x text        Text sent by the host after the boot. \\xNN sends a byte.\n"
+        "  -i file        File sent by the host after the boot (- for stdin).\n"
+        "  -k file        Key script with \"<ms> <pin> <0|1>\" lines. Pins are key, dah,\n"
+        "                 enc, enca, encb, ptt and mem. 1 closes the switch.\n"
+        "  -b baud        Host baud rate (default follows the keyer).\n"
+        "  -f             Ignore XON / XOFF flow control of the keyer.\n"
+        "  -p             Connect the keyer UART to a pseudo-terminal and run until\n"
+        "                 interrupted. Keying, PTT and display log goes to stdout.\n"
+        "  -r factor      Run at the given multiple of the real time, 0 runs as fast as\n"
+        "                 possible (default 1 with -p, otherwise 0).\n"
+        "  -l file        Write the keying, PTT and display log (- for stdout).\n", name, DEFAULT_RUN_TIME);
+}
+
+// Host text with the C style \xNN, \r, \n and \\ escapes.
+static void appendEscaped(const char *text, std::string &content)
+{
+    char hexText[3], *endPos;
+    
+    while(*text != '\0')
+    {
+        if(text[0] != '\\')
+        {
+            content += *text++;
+            continue;
+        }
+        
+        switch(text[1])
+        {
+            case 'x':
+                hexText[0] = text[2];
+                hexText[1] = (text[2] != '\0') ? text[3] : '\0';
+                hexText[2] = '\0';
+                
+                content += (char)strtoul(hexText, &endPos, 16);
+                text += 2 + (endPos - hexText);
+                break;
+            case 'r':
+                content += '\r';
+                text += 2;
+                break;
+            case 'n':
+                content += '\n';
+                text += 2;
+                break;
+            case '\0':
+                content += *text++;
+                break;
+            default:
+                content += text[1];
+                text += 2;
+        }
+    }
+}
+
+static bool loadFile(const char *fileName, std::string &content)
+{
+    FILE *file = (strcmp(fileName, "-") == 0) ? stdin : fopen(fileName, "rb");
+    char buffer[512];
+    size_t length;
+    
+    if(file == NULL)
+    {
+        return false;
+    }
+    
+    while((length = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        content.append(buffer, length);
+    }
+    
+    if(file != stdin)
+    {
+        fclose(file);
+    }
+    
+    return true;
+}
+
+static unsigned char pinByName(const char *name)
+{
+    static const struct
+    {
+        const char *name;
+        unsigned char pins;
+    } pinNames[] = 
+    {
+        {"key", PIN_KEY}, {"dit", PIN_KEY}, {"dah", PIN_DAH}, {"enc", PIN_ENCODER_SW}, 
+        {"enca", PIN_ENCODER_A}, {"encb", PIN_ENCODER_B}, {"ptt", PIN_PTT_SW}, {"mem", PIN_MEM_SW}
+    };
+    unsigned char namePos;
+    
+    for(namePos = 0; namePos < (sizeof(pinNames) / sizeof(pinNames[0])); namePos++)
+    {
+        if(strcmp(name, pinNames[namePos].name) == 0)
+        {
+            return pinNames[namePos].pins;
+        }
+    }
+    
+    return 0;
+}
+
+static bool loadKeyScript(const char *fileName, std::vector<KeyEvent> &events)
+{
+    FILE *file = fopen(fileName, "r");
+    char line[128], pinName[16];
+    double timeMs;
+    int state;
+    KeyEvent event;
+    unsigned int lineNumber = 0;
+    
+    if(file == NULL)
+    {
+        return false;
+    }
+    
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        lineNumber++;
+        
+        if((line[0] == '#') || (strspn(line, " \t\r\n") == strlen(line)))
+        {
+            continue;
+        }
+        
+        if((sscanf(line, "%lf %15s %d", &timeMs, pinName, &state) != 3) || (pinByName(pinName) == 0))
+        {
+            fprintf(stderr, "%s:%u: invalid key event\n", fileName, lineNumber);
+            fclose(file);
+            return false;
+        }
+        
+        event.time = (simTime)(timeMs * SIM_MS);
+        event.pins = pinByName(pinName);
+        event.closed = (state != 0);
+        events.push_back(event);
+    }
+    
+    fclose(file);
+    return true;
+}
+
+static void stopSimulation(int signalNumber)
+{
+    stopRequest = 1;
+}
+
+static double wallClock()
+{
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+static bool loadEeprom(const char *fileName)
+{
+    FILE *file = fopen(fileName, "rb");
+    
+    // Missing image starts with an erased E2PROM.
+    if(file == NULL)
+    {
+        return true;
+    }
+    
+    if(fread(sim.eeprom, 1, EEPROM_SIZE, file) != EEPROM_SIZE)
+    {
+        fclose(file);
+        return false;
+    }
+    
+    fclose(file);
+    return true;
+}
+
+static void saveEeprom(const char *fileName)
+{
+    FILE *file = fopen(fileName, "wb");
+    
+    if(file != NULL)
+    {
+        fwrite(sim.eeprom, 1, EEPROM_SIZE, file);
+        fclose(file);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    simTime runTime = SIM_NEVER;
+    simTime stepEnd;
+    const char *vcdFile = NULL;
+    const char *eepromFile = NULL;
+    const char *logFile = NULL;
+    std::string hostText;
+    std::vector<KeyEvent> keyEvents;
+    int settings[MAX_SETTINGS];
+    bool presetSettings = false;
+    VcdTrace trace;
+    EventLog eventLog;
+    PseudoTerminal terminal;
+    bool ptyMode = false;
+    double speedFactor = -1, wallStart, waitTime;
+    size_t eventPos = 0;
+    unsigned char value;
+    char *valueText;
+    int option, field;
+    
+    for(field = 0; field < MAX_SETTINGS; field++)
+    {
+        settings[field] = -1;
+    }
+    
+    while((option = getopt(argc, argv, "t:v:e:s:x:i:k:b:fpr:l:h")) != -1)
+    {
+        switch(option)
+        {
+            case 't':
+                runTime = (simTime)(atof(optarg) * SIM_MS);
+                break;
+            case 'v':
+                vcdFile = optarg;
+                break;
+            case 'e':
+                eepromFile = optarg;
+                break;
+            case 's':
+                valueText = strchr(optarg, '=');
+                if(valueText == NULL)
+                {
+                    printUsage(argv[0]);
+                    return 1;
+                }
+                
+                *valueText++ = '\0';
+                field = ((optarg[0] >= '0') && (optarg[0] <= '9')) ? atoi(optarg) : firmwareSettingsField(optarg);
+                
+                if((field < 0) || (field >= firmwareSettingsCount()))
+                {
+                    fprintf(stderr, "Unknown setting: %s\n", optarg);
+                    return 1;
+                }
+                
+                settings[field] = atoi(valueText);
+                presetSettings = true;
+                break;
+            case 'x':
+                appendEscaped(optarg, hostText);
+                break;
+            case 'i':
+                if(!loadFile(optarg, hostText))
+                {
+                    perror(optarg);
+                    return 1;
+                }
+                break;
+            case 'k':
+                if(!loadKeyScript(optarg, keyEvents))
+                {
+                    return 1;
+                }
+                break;
+            case 'b':
+                sim.hostBaud = strtoul(optarg, NULL, 10);
+                break;
+            case 'f':
+                sim.hostFlowControl = false;
+                break;
+            case 'p':
+                ptyMode = true;
+                break;
+            case 'r':
+                speedFactor = atof(optarg);
+                break;
+            case 'l':
+                logFile = optarg;
+                break;
+            default:
+                printUsage(argv[0]);
+                return (option == 'h') ? 0 : 1;
+        }
+    }
+    
+    // Pseudo-terminal runs in real time until it's interrupted.
+    if(runTime == SIM_NEVER)
+    {
+        runTime = ptyMode ? SIM_NEVER : (DEFAULT_RUN_TIME * SIM_MS);
+    }
+    
+    if(speedFactor < 0)
+    {
+        speedFactor = ptyMode ? 1.0 : 0.0;
+    }
+    
+    if((logFile == NULL) && ptyMode)
+    {
+        logFile = "-";
+    }
+    
+    if((eepromFile != NULL) && !loadEeprom(eepromFile))
+    {
+        fprintf(stderr, "%s: invalid E2PROM image\n", eepromFile);
+        return 1;
+    }
+    
+    if(presetSettings)
+    {
+        firmwarePresetSettings(settings, firmwareSettingsCount());
+    }
+    
+    if(vcdFile != NULL)
+    {
+        if(!trace.open(vcdFile))
+        {
+            perror(vcdFile);
+            return 1;
+        }
+        
+        sim.observers.push_back(&trace);
+    }
+    
+    if(logFile != NULL)
+    {
+        if(!eventLog.open(logFile))
+        {
+            perror(logFile);
+            return 1;
+        }
+        
+        sim.observers.push_back(&eventLog);
+    }
+    
+    if(ptyMode)
+    {
+        if(!terminal.open())
+        {
+            perror("Pseudo-terminal");
+            return 1;
+        }
+        
+        fprintf(stderr, "Keyer serial port: %s\n", terminal.name().c_str());
+        
+        // Host application on the terminal serves the flow control of the keyer.
+        sim.hostFlowControl = false;
+        sim.hostReceive = [&terminal](unsigned char value)
+        {
+            terminal.write(value);
+        };
+    }
+    else
+    {
+        // Characters sent by the keyer go to the standard output.
+        sim.hostReceive = [](unsigned char value)
+        {
+            if((value != 0x11) && (value != 0x13))
+            {
+                fputc(value, stdout);
+            }
+        };
+    }
+    
+    signal(SIGINT, stopSimulation);
+    signal(SIGTERM, stopSimulation);
+    
+    sim.boot();
+    wallStart = wallClock();
+    
+    for(char value : hostText)
+    {
+        sim.sendToKeyer((unsigned char)value);
+    }
+    
+    // Key script events and the terminal data are applied between the simulation steps.
+    while((sim.now < runTime) && (stopRequest == 0))
+    {
+        if((eventPos < keyEvents.size()) && (keyEvents[eventPos].time <= sim.now))
+        {
+            sim.setInput(keyEvents[eventPos].pins, keyEvents[eventPos].closed);
+            eventPos++;
+            continue;
+        }
+        
+        stepEnd = ((eventPos < keyEvents.size()) && (keyEvents[eventPos].time < runTime)) ? keyEvents[eventPos].time : runTime;
+        
+        if(ptyMode || (speedFactor > 0) || (logFile != NULL))
+        {
+            stepEnd = std::min(stepEnd, (simTime)(sim.now + UPDATE_SLICE));
+        }
+        
+        if(ptyMode)
+        {
+            // Host data is taken while the receive queue is short, so the host 
+            // receives XOFF of the keyer before it has sent much more.
+            while((sim.pendingToKeyer() < 2) && terminal.read(value))
+            {
+                sim.sendToKeyer(value);
+            }
+        }
+        
+        // Virtual clock is held back to the given multiple of the wall clock.
+        if(speedFactor > 0)
+        {
+            waitTime = (((double)stepEnd / SIM_MS / 1000.0) / speedFactor) - (wallClock() - wallStart);
+            
+            if(ptyMode)
+            {
+                terminal.wait((int)(waitTime * 1000));
+            }
+            else if(waitTime > 0)
+            {
+                usleep((useconds_t)(waitTime * 1e6));
+            }
+            
+            if((wallClock() - wallStart) < (((double)stepEnd / SIM_MS / 1000.0) / speedFactor))
+            {
+                // Host data is arrived before the end of the step.
+                continue;
+            }
+        }
+        
+        sim.runUntil(stepEnd);
+        eventLog.flush();
+    }
+    
+    trace.close();
+    eventLog.close();
+    fflush(stdout);
+    
+    if(eepromFile != NULL)
+    {
+        saveEeprom(eepromFile);
+    }
+    
+    fprintf(stderr, "\n+----------------+\n|%s|\n|%s|\n+----------------+\n", sim.lcd->row(0).c_str(), sim.lcd->row(1).c_str());
+    fprintf(stderr, "Interrupts: %lu, tasks: %lu, UART overruns: %lu, framing errors: %lu, LCD busy violations: %lu\n", 
+        sim.interruptCount, sim.taskCount, sim.overrunCount, sim.framingErrorCount, sim.lcd->busyViolations);
+    
+    return 0;
+}
@@ -0,0 +1,108 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "pty.h"
+
+PseudoTerminal::PseudoTerminal()
+{
+    master = -1;
+    slave = -1;
+}
+
+PseudoTerminal::~PseudoTerminal()
+{
+    close();
+}
+
+bool PseudoTerminal::open()
+{
+    struct termios settings;
+    
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0) || (ptsname(master) == NULL))
+    {
+        close();
+        return false;
+    }
+    
+    slaveName = ptsname(master);
+    
+    // Slave is kept open, so the master does not hang up while no host is 
+    // connected. Host applications set the line to raw mode, but the default 
+    // line discipline is cleared for the hosts which do not.
+    slave = ::open(slaveName.c_str(), O_RDWR | O_NOCTTY);
+    if((slave >= 0) && (tcgetattr(slave, &settings) == 0))
+    {
+        cfmakeraw(&settings);
+        tcsetattr(slave, TCSANOW, &settings);
+    }
+    
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+void PseudoTerminal::close()
+{
+    if(slave >= 0)
+    {
+        ::close(slave);
+        slave = -1;
+    }
+    
+    if(master >= 0)
+    {
+        ::close(master);
+        master = -1;
+    }
+}
+
+bool PseudoTerminal::read(unsigned char &value)
+{
+    return (master >= 0) && (::read(master, &value, 1) == 1);
+}
+
+void PseudoTerminal::write(unsigned char value)
+{
+    if(master >= 0)
+    {
+        if(::write(master, &value, 1) != 1)
+        {
+            // Host does not read the terminal.
+        }
+    }
+}
+
+void PseudoTerminal::wait(int timeout)
+{
+    struct pollfd terminalPoll = {master, POLLIN, 0};
+    
+    if(timeout > 0)
+    {
+        poll(&terminalPoll, 1, timeout);
+    }
+}
@@ -0,0 +1,56 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef SIM_PTY_H
+#define	SIM_PTY_H
+
+#include <string>
+
+// Pseudo-terminal which stands for the USB serial port of the keyer. Host 
+// applications open the slave device (/dev/pts/N) as a serial port.
+class PseudoTerminal
+{
+public:
+    PseudoTerminal();
+    ~PseudoTerminal();
+    
+    bool open();
+    void close();
+    
+    const std::string &name() const { return slaveName; }
+    int handle() const { return master; }
+    
+    // Non-blocking transfers. Bytes are dropped while the host does not read 
+    // the terminal.
+    bool read(unsigned char &value);
+    void write(unsigned char value);
+    
+    // Wait for the host data up to the given time in milliseconds.
+    void wait(int timeout);
+    
+private:
+    int master;
+    int slave;
+    std::string slaveName;
+};
+
+#endif	/* SIM_PTY_H */
@@ -0,0 +1,583 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+// Regression tests of the firmware behaviour. Every test boots the simulated 
+// keyer in a forked process because the firmware state can not be reset.
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <regex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "hardware.h"
+#include "firmware.h"
+#include "lcd.h"
+
+#define MAX_SETTINGS    32
+
+// Time given to the firmware to finish the boot before the stimulus.
+#define SETTLE_TIME     (1000 * SIM_MS)
+
+// E2PROM layout of the message slots (31 characters and the end marker).
+#define MEM_SLOT_BASE   8
+#define MEM_SLOT_SIZE   32
+
+// Contest serial number (low byte first).
+#define MEM_SERIAL_ADDR 4
+
+// Event trace dump: marker, entry count and the push event of the letter E.
+#define TRACE_MARKER    0xFE
+#define TRACE_SIZE      8
+#define TRACE_PUSH_E    0xA5
+
+#define CHECK(condition) \
+    do \
+    { \
+        if(!(condition)) \
+        { \
+            fprintf(stderr, "  %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            return false; \
+        } \
+    } while(0)
+
+typedef std::vector<std::pair<const char *, int>> SettingList;
+
+struct TestCase
+{
+    const char *name;
+    bool (*run)(void);
+};
+
+// Keying and PTT outputs and the text echoed to the host.
+class OutputMonitor : public SimObserver
+{
+public:
+    OutputMonitor() : pttActive(false), toneActive(false), marks(0) {}
+    
+    void portChanged(char port, unsigned char value) override
+    {
+        if(port == 'C')
+        {
+            pttActive = ((value & PIN_PTT) != 0);
+        }
+    }
+    
+    void toneChanged(bool active, unsigned char duty, unsigned long frequency) override
+    {
+        if(active && !toneActive)
+        {
+            marks++;
+        }
+        
+        toneActive = active;
+    }
+    
+    bool pttActive;
+    bool toneActive;
+    unsigned int marks;
+    std::string hostText;
+};
+
+static OutputMonitor monitor;
+
+// Preset the given settings (all others keep the defaults) and boot the firmware.
+static void bootKeyer(const SettingList &settingList)
+{
+    int settings[MAX_SETTINGS];
+    int field;
+    
+    for(field = 0; field < MAX_SETTINGS; field++)
+    {
+        settings[field] = -1;
+    }
+    
+    for(const std::pair<const char *, int> &setting : settingList)
+    {
+        settings[firmwareSettingsField(setting.first)] = setting.second;
+    }
+    
+    firmwarePresetSettings(settings, firmwareSettingsCount());
+    
+    sim.hostReceive = [](unsigned char value)
+    {
+        monitor.hostText += (char)value;
+    };
+    
+    sim.observers.push_back(&monitor);
+    sim.boot();
+    sim.runUntil(SETTLE_TIME);
+}
+
+static void sendText(const char *text)
+{
+    while(*text != '\0')
+    {
+        sim.sendToKeyer((unsigned char)*text++);
+    }
+}
+
+static void runFor(simTime duration)
+{
+    sim.runUntil(sim.now + duration);
+}
+
+// Close the switch for the given time and wait for the same time after the release.
+static void pressButton(unsigned char pins, simTime duration)
+{
+    sim.setInput(pins, true);
+    runFor(duration);
+    sim.setInput(pins, false);
+    runFor(duration);
+}
+
+// Turn the rotary encoder clockwise by the given number of steps.
+static void turnEncoder(unsigned int steps)
+{
+    while(steps-- > 0)
+    {
+        pressButton(PIN_ENCODER_A, 20 * SIM_MS);
+    }
+}
+
+// Host abort while the first mark waits for the PTT lead-in (50ms) releases the 
+// PTT after the hang time and keeps the sidetone off.
+static bool testAbortInLeadIn(void)
+{
+    bootKeyer({{"input", 0}, {"keyer", 1}, {"ptt", 3}, {"keying", 2}});
+    
+    sendText("EEEEE");
+    runFor(25 * SIM_MS);
+    CHECK(monitor.pttActive);
+    
+    sim.sendToKeyer(0x1B);
+    runFor(3000 * SIM_MS);
+    
+    CHECK(!monitor.pttActive);
+    CHECK(!monitor.toneActive);
+    CHECK(monitor.marks == 0);
+    
+    return true;
+}
+
+// Dual input mode records the characters decoded from the straight key. Keying 
+// continues after the memory slot is full, and the recording is closed after the 
+// last slot position.
+static bool testRecordFullSlot(void)
+{
+    unsigned char slot[MEM_SLOT_SIZE];
+    unsigned int charPos;
+    
+    bootKeyer({{"input", 2}, {"keyer", 0}, {"speed", 2}, {"record", 0}});
+    
+    // MEM press opens the memory manager and MEM hold starts the recording.
+    pressButton(PIN_MEM_SW, 100 * SIM_MS);
+    pressButton(PIN_MEM_SW, 4000 * SIM_MS);
+    
+    // 40 times E at 15 WPM (80ms unit) with the long character gaps.
+    for(charPos = 0; charPos < 40; charPos++)
+    {
+        pressButton(PIN_KEY, 80 * SIM_MS);
+        runFor(320 * SIM_MS);
+    }
+    
+    runFor(1000 * SIM_MS);
+    pressButton(PIN_ENCODER_SW, 100 * SIM_MS);
+    runFor(1000 * SIM_MS);
+    
+    memcpy(slot, &sim.eeprom[MEM_SLOT_BASE], MEM_SLOT_SIZE);
+    
+    CHECK(monitor.hostText.find(std::string(40, 'E')) != std::string::npos);
+    CHECK(std::string((const char *)slot, MEM_SLOT_SIZE - 1) == std::string(MEM_SLOT_SIZE - 1, 'E'));
+    CHECK(slot[MEM_SLOT_SIZE - 1] == 0xFF);
+    
+    return true;
+}
+
+// Play the message slot 1 (without the loop) from the memory manager and count 
+// the sent marks.
+static unsigned int playSlot(const char *content)
+{
+    memcpy(&sim.eeprom[MEM_SLOT_BASE], content, strlen(content));
+    
+    bootKeyer({{"input", 1}, {"keyer", 0}, {"speed", 2}, {"keying", 1}, {"loop", 1}});
+    
+    pressButton(PIN_MEM_SW, 100 * SIM_MS);
+    pressButton(PIN_ENCODER_SW, 100 * SIM_MS);
+    runFor(10000 * SIM_MS);
+    
+    return monitor.marks;
+}
+
+// Chain marker without a valid slot number is ignored and the playback stops at 
+// the end of the message. Slot content after the end marker must not be sent.
+static bool testChainAtEnd(void)
+{
+    // CQ is sent with 8 marks.
+    CHECK(playSlot("CQ@\xFF" "EEEE\xFF") == 8);
+    
+    return true;
+}
+
+static bool testChainInvalidSlot(void)
+{
+    CHECK(playSlot("CQ@9\xFF" "EEEE\xFF") == 8);
+    
+    return true;
+}
+
+// Memory slot upload is rejected after the host link is silent, and a new upload 
+// gets the message buffer.
+static bool testSlotUploadTimeout(void)
+{
+    bootKeyer({{"input", 0}});
+    
+    sendText("\x17" "1");
+    runFor(100 * SIM_MS);
+    CHECK(monitor.hostText == ">");
+    
+    sendText("4142");
+    runFor(3000 * SIM_MS);
+    CHECK(monitor.hostText == ">?\r\n");
+    
+    sendText("\x17" "1");
+    runFor(100 * SIM_MS);
+    sendText("4142\r");
+    runFor(500 * SIM_MS);
+    CHECK(monitor.hostText == ">?\r\n>OK\r\n");
+    CHECK(memcmp(&sim.eeprom[MEM_SLOT_BASE], "AB\xFF", 3) == 0);
+    
+    return true;
+}
+
+static bool testSlotUploadCancel(void)
+{
+    bootKeyer({{"input", 0}});
+    
+    sendText("\x17" "1");
+    runFor(100 * SIM_MS);
+    sendText("41\x1B");
+    runFor(500 * SIM_MS);
+    CHECK(monitor.hostText == ">?\r\n");
+    CHECK(sim.eeprom[MEM_SLOT_BASE] == 0xFF);
+    
+    return true;
+}
+
+// Diagnostics report and the slot read reply requested together are not mixed.
+static bool testRepliesInSequence(void)
+{
+    memcpy(&sim.eeprom[MEM_SLOT_BASE], "CQ\xFF", 3);
+    bootKeyer({{"input", 0}});
+    
+    sendText("\x05\x07" "1");
+    runFor(500 * SIM_MS);
+    
+    CHECK(std::regex_match(monitor.hostText, std::regex("BOOT=[0-9]+ MISS=[0-9]+ WPM=[0-9]+ OVR=0( STACK=[0-9]+)?\r\n4351\r\n")));
+    
+    return true;
+}
+
+// Host text sent while the keyer sleeps overruns the UART receiver. Receiver is 
+// restarted after the wake-up and the overrun is reported by the diagnostics.
+static bool testReceiveOverrun(void)
+{
+    bootKeyer({{"input", 0}});
+    runFor(100 * SIM_MS);
+    
+    // Host keeps sending while the interrupts are masked, as in the sleep mode. 
+    // Third byte finds the receive FIFO full.
+    GIE = 0;
+    sendText("EEEE");
+    runFor(100 * SIM_MS);
+    CHECK(sim.overrunCount > 0);
+    GIE = 1;
+    runFor(100 * SIM_MS);
+    
+    // Receiver is running again and the overrun is reported.
+    sendText("\x05");
+    runFor(500 * SIM_MS);
+    CHECK(std::regex_search(monitor.hostText, std::regex(" OVR=1( STACK=[0-9]+)?\r\n")));
+    
+    return true;
+}
+
+// Speed option out of the menu range, as in the settings migrated from the older 
+// firmware, falls back to the default 5 WPM.
+static bool testSettingOutOfRange(void)
+{
+    bootKeyer({{"speed", 3}});
+    
+    sendText("\x05");
+    runFor(500 * SIM_MS);
+    CHECK(monitor.hostText.find(" WPM=5 ") != std::string::npos);
+    
+    return true;
+}
+
+// "Reset to 001" option of the serial number sub menu restarts the contest 
+// serial numbers.
+static bool testSerialReset(void)
+{
+    sim.eeprom[MEM_SERIAL_ADDR] = 42;
+    sim.eeprom[MEM_SERIAL_ADDR + 1] = 0;
+    bootKeyer({});
+    
+    // Serial number is the 11th item of the system menu.
+    pressButton(PIN_ENCODER_SW, 100 * SIM_MS);
+    turnEncoder(10);
+    pressButton(PIN_ENCODER_SW, 100 * SIM_MS);
+    turnEncoder(1);
+    pressButton(PIN_ENCODER_SW, 100 * SIM_MS);
+    runFor(100 * SIM_MS);
+    
+    CHECK(sim.eeprom[MEM_SERIAL_ADDR] == 1);
+    CHECK(sim.eeprom[MEM_SERIAL_ADDR + 1] == 0);
+    
+    return true;
+}
+
+// Display instructions are not sent while the controller is busy, through the 
+// text window roll up and the clear of the menu screen.
+static bool testLcdBusy(void)
+{
+    bootKeyer({{"input", 0}, {"speed", 2}});
+    
+    sendText("CQ CQ CQ DE TEST TEST TEST PSE K ");
+    runFor(40000 * SIM_MS);
+    pressButton(PIN_ENCODER_SW, 100 * SIM_MS);
+    runFor(500 * SIM_MS);
+    
+    CHECK(sim.lcd->busyViolations == 0);
+    
+    return true;
+}
+
+// Rotary encoder button held down in a sub menu steps the options, once at the 
+// long press (1.2s) and then every 200ms. Release after the hold does not select.
+static bool testSubMenuRepeat(void)
+{
+    bootKeyer({{"input", 0}, {"speed", 0}});
+    
+    // Morse speed is the 3rd item of the system menu.
+    pressButton(PIN_ENCODER_SW, 100 * SIM_MS);
+    turnEncoder(2);
+    pressButton(PIN_ENCODER_SW, 100 * SIM_MS);
+    
+    sim.setInput(PIN_ENCODER_SW, true);
+    runFor(1500 * SIM_MS);
+    sim.setInput(PIN_ENCODER_SW, false);
+    runFor(100 * SIM_MS);
+    CHECK(sim.lcd->row(1).compare(0, 6, "15 WPM") == 0);
+    
+    pressButton(PIN_ENCODER_SW, 100 * SIM_MS);
+    sendText("\x05");
+    runFor(500 * SIM_MS);
+    CHECK(monitor.hostText.find(" WPM=15 ") != std::string::npos);
+    
+    return true;
+}
+
+// Typeahead buffer holds 128 characters from the host which ignores the flow 
+// control.
+static bool testTypeaheadSize(void)
+{
+    bootKeyer({{"input", 0}, {"speed", 2}});
+    sim.hostFlowControl = false;
+    
+    sendText(std::string(128, 'E').c_str());
+    runFor(60000 * SIM_MS);
+    
+    CHECK(std::count(monitor.hostText.begin(), monitor.hostText.end(), 'E') == 128);
+    
+    return true;
+}
+
+// WinKeyer host software opens the port at 1200 baud. Keyer idling with the low 
+// frequency clock answers the admin open with the version.
+static bool testWinkeyAt1200(void)
+{
+    sim.hostBaud = 1200;
+    bootKeyer({{"baud", 4}});
+    runFor(2000 * SIM_MS);
+    
+    sim.sendToKeyer(0x00);
+    sim.sendToKeyer(0x02);
+    runFor(500 * SIM_MS);
+    CHECK(!monitor.hostText.empty() && (monitor.hostText[0] == 23));
+    
+    return true;
+}
+
+// EEPROM image of the WinKeyer load command is dropped and the session goes on 
+// with the next command.
+static bool testWinkeyLoadEeprom(void)
+{
+    bootKeyer({{"input", 0}});
+    
+    sim.sendToKeyer(0x00);
+    sim.sendToKeyer(0x02);
+    sim.sendToKeyer(0x00);
+    sim.sendToKeyer(0x0D);
+    sendText(std::string(256, 'E').c_str());
+    sim.sendToKeyer(0x00);
+    sim.sendToKeyer(0x04);
+    sim.sendToKeyer('U');
+    runFor(2000 * SIM_MS);
+    
+    // Keyed characters are echoed to the host.
+    CHECK(monitor.hostText.find('E') == std::string::npos);
+    CHECK(monitor.hostText.find('U') != std::string::npos);
+    
+    return true;
+}
+
+// WinKeyer buffered speed change takes effect after the text queued before it.
+static bool testWinkeyBufferedSpeed(void)
+{
+    std::string speedReports;
+    
+    bootKeyer({{"input", 0}});
+    
+    sim.sendToKeyer(0x00);
+    sim.sendToKeyer(0x02);
+    sim.sendToKeyer(0x02);
+    sim.sendToKeyer(5);
+    sendText("EEEEEE");
+    sim.sendToKeyer(0x1C);
+    sim.sendToKeyer(15);
+    sim.sendToKeyer(0x07);
+    runFor(10000 * SIM_MS);
+    sim.sendToKeyer(0x07);
+    runFor(500 * SIM_MS);
+    
+    // Speed pot reports are 0x80 - 0xBF, status bytes are 0xC0 and above.
+    for(char value : monitor.hostText)
+    {
+        if(((unsigned char)value & 0xC0) == 0x80)
+        {
+            speedReports += value;
+        }
+    }
+    
+    CHECK(speedReports == "\x85\x8F");
+    
+    return true;
+}
+
+// Event trace is served by the default build. Dump holds the marker, the ticks 
+// since the newest entry, the entry count and the entries, the newest is last.
+static bool testTraceDump(void)
+{
+    size_t dumpPos;
+    
+    bootKeyer({{"input", 0}, {"speed", 2}});
+    
+    sendText("E");
+    runFor(1000 * SIM_MS);
+    sendText("\x18");
+    runFor(500 * SIM_MS);
+    
+    dumpPos = monitor.hostText.find((char)TRACE_MARKER);
+    CHECK(dumpPos != std::string::npos);
+    CHECK(monitor.hostText.size() >= (dumpPos + 3 + (2 * TRACE_SIZE)));
+    CHECK(monitor.hostText[dumpPos + 2] == TRACE_SIZE);
+    
+    // Text character is pushed into the typeahead buffer.
+    CHECK(monitor.hostText.find((char)TRACE_PUSH_E, dumpPos + 3) != std::string::npos);
+    
+    return true;
+}
+
+static const TestCase testCases[] = 
+{
+    {"abort in PTT lead-in", testAbortInLeadIn},
+    {"record full slot", testRecordFullSlot},
+    {"macro chain at the end", testChainAtEnd},
+    {"macro chain to invalid slot", testChainInvalidSlot},
+    {"slot upload timeout", testSlotUploadTimeout},
+    {"slot upload cancel", testSlotUploadCancel},
+    {"host replies in sequence", testRepliesInSequence},
+    {"receive overrun", testReceiveOverrun},
+    {"setting out of range", testSettingOutOfRange},
+    {"serial number reset", testSerialReset},
+    {"LCD busy time", testLcdBusy},
+    {"sub menu repeat", testSubMenuRepeat},
+    {"typeahead size", testTypeaheadSize},
+    {"WinKeyer at 1200 baud", testWinkeyAt1200},
+    {"WinKeyer load EEPROM", testWinkeyLoadEeprom},
+    {"WinKeyer buffered speed", testWinkeyBufferedSpeed},
+    {"trace dump", testTraceDump}
+};
+
+static bool forkTest(const TestCase &testCase)
+{
+    int status;
+    pid_t child;
+    
+    // Pending output would be written again by the child.
+    fflush(stdout);
+    fflush(stderr);
+    
+    child = fork();
+    if(child == 0)
+    {
+        _exit(testCase.run() ? 0 : 1);
+    }
+    
+    return (child > 0) && (waitpid(child, &status, 0) == child) && WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int testPos, testRuns = 0, failures = 0;
+    
+    for(testPos = 0; testPos < (sizeof(testCases) / sizeof(testCases[0])); testPos++)
+    {
+        // Optional arguments select the tests by name.
+        if((argc > 1) && (strstr(testCases[testPos].name, argv[1]) == NULL))
+        {
+            continue;
+        }
+        
+        testRuns++;
+        
+        if(forkTest(testCases[testPos]))
+        {
+            printf("PASS  %s\n", testCases[testPos].name);
+        }
+        else
+        {
+            printf("FAIL  %s\n", testCases[testPos].name);
+            failures++;
+        }
+    }
+    
+    printf("%u of %u tests failed\n", failures, testRuns);
+    
+    return (failures == 0) ? 0 : 1;
+}
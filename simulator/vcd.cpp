@@ -0,0 +1,301 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <time.h>
+
+#include "vcd.h"
+
+VcdTrace::VcdTrace() : file(NULL), lastTime(0), timeWritten(false), interruptCount(0), taskCount(0)
+{
+    // Pins are idle high (pull-ups) and the serial lines are in the mark state.
+    sigKey = declare("pins", "key_rb3", 1, 1);
+    sigDah = declare("pins", "dah_rb4", 1, 1);
+    sigEncoderA = declare("pins", "encoder_a_rb0", 1, 1);
+    sigEncoderB = declare("pins", "encoder_b_rb1", 1, 1);
+    sigEncoderSwitch = declare("pins", "encoder_sw_rb2", 1, 1);
+    sigPttSwitch = declare("pins", "ptt_sw_rb5", 1, 1);
+    sigMemSwitch = declare("pins", "mem_sw_rb6", 1, 1);
+    sigPtt = declare("pins", "ptt_rc3", 1, 0);
+    sigMute = declare("pins", "mute_rc4", 1, 0);
+    sigBacklight = declare("pins", "backlight_rc5", 1, 0);
+    sigLcdE = declare("pins", "lcd_e_ra3", 1, 0);
+    sigLcdRs = declare("pins", "lcd_rs_ra2", 1, 0);
+    sigLcdData = declare("pins", "lcd_data_ra7_4", 4, 0);
+    sigTone = declare("pins", "tone_ccp1", 1, 0);
+    sigToneDuty = declare("pins", "tone_duty", 8, 0);
+    sigToneFrequency = declare("pins", "tone_hz", 16, 0);
+    sigUartRx = declare("pins", "uart_rx_rc7", 1, 1);
+    sigUartTx = declare("pins", "uart_tx_rc6", 1, 1);
+    sigRxData = declare("pins", "uart_rx_data", 8, 0);
+    sigTxData = declare("pins", "uart_tx_data", 8, 0);
+    sigRxError = declare("pins", "uart_rx_framing_error", 1, 0);
+    
+    sigQueueDepth = declare("firmware", "queue_depth", 8, 0);
+    sigMorseElements = declare("firmware", "morse_buffer_pos", 8, 0);
+    sigKeyState = declare("firmware", "key_filtered", 8, 0);
+    sigLastQueued = declare("firmware", "last_queued_char", 8, 0);
+    sigTxPattern = declare("firmware", "tx_pattern", 8, 0);
+    sigTxKeyed = declare("firmware", "tx_keyed", 1, 0);
+    sigPttState = declare("firmware", "ptt_state", 2, 0);
+    sigClockSlow = declare("firmware", "clock_slow", 1, 0);
+    sigScreen = declare("firmware", "ui_screen", 3, 0);
+    sigTaskReady = declare("firmware", "task_ready", 8, 0);
+    sigSpeed = declare("firmware", "speed_wpm", 8, 0);
+    sigContext = declare("firmware", "last_context", 8, 0);
+    sigInterrupts = declare("firmware", "isr_count", 32, 0);
+    sigTasks = declare("firmware", "task_count", 32, 0);
+}
+
+VcdTrace::~VcdTrace()
+{
+    close();
+}
+
+bool VcdTrace::open(const char *fileName)
+{
+    std::string scope;
+    unsigned char signal;
+    time_t timeNow = time(NULL);
+    
+    file = fopen(fileName, "w");
+    if(file == NULL)
+    {
+        return false;
+    }
+    
+    fprintf(file, "$date %s$end\n", ctime(&timeNow));
+    fprintf(file, "$version USB Morse Keyer simulator $end\n");
+    fprintf(file, "$timescale 1ns $end\n");
+    fprintf(file, "$scope module keyer $end\n");
+    
+    for(signal = 0; signal < signals.size(); signal++)
+    {
+        if(signals[signal].scope != scope)
+        {
+            if(!scope.empty())
+            {
+                fprintf(file, "$upscope $end\n");
+            }
+            
+            scope = signals[signal].scope;
+            fprintf(file, "$scope module %s $end\n", scope.c_str());
+        }
+        
+        fprintf(file, "$var wire %u %s %s $end\n", signals[signal].width, identifier(signal).c_str(), signals[signal].name.c_str());
+    }
+    
+    fprintf(file, "$upscope $end\n$upscope $end\n$enddefinitions $end\n");
+    fprintf(file, "#%llu\n$dumpvars\n", (unsigned long long)sim.now);
+    
+    for(signal = 0; signal < signals.size(); signal++)
+    {
+        writeValue(signal);
+    }
+    
+    fprintf(file, "$end\n");
+    
+    lastTime = sim.now;
+    timeWritten = true;
+    return true;
+}
+
+void VcdTrace::close()
+{
+    if(file == NULL)
+    {
+        return;
+    }
+    
+    // UART bits after the end of the run are written too.
+    flush(SIM_NEVER);
+    fprintf(file, "#%llu\n", (unsigned long long)((sim.now > lastTime) ? sim.now : lastTime));
+    
+    fclose(file);
+    file = NULL;
+}
+
+void VcdTrace::portChanged(char port, unsigned char value)
+{
+    if(port == 'A')
+    {
+        changeNow(sigLcdE, (value >> 3) & 0x01);
+        changeNow(sigLcdRs, (value >> 2) & 0x01);
+        changeNow(sigLcdData, value >> 4);
+    }
+    else if(port == 'B')
+    {
+        changeNow(sigEncoderA, value & 0x01);
+        changeNow(sigEncoderB, (value >> 1) & 0x01);
+        changeNow(sigEncoderSwitch, (value >> 2) & 0x01);
+        changeNow(sigKey, (value >> 3) & 0x01);
+        changeNow(sigDah, (value >> 4) & 0x01);
+        changeNow(sigPttSwitch, (value >> 5) & 0x01);
+        changeNow(sigMemSwitch, (value >> 6) & 0x01);
+    }
+    else if(port == 'C')
+    {
+        changeNow(sigPtt, (value >> 3) & 0x01);
+        changeNow(sigMute, (value >> 4) & 0x01);
+        changeNow(sigBacklight, (value >> 5) & 0x01);
+    }
+}
+
+void VcdTrace::toneChanged(bool active, unsigned char duty, unsigned long frequency)
+{
+    changeNow(sigTone, active ? 1 : 0);
+    changeNow(sigToneDuty, duty);
+    changeNow(sigToneFrequency, frequency);
+}
+
+void VcdTrace::uartByte(bool fromKeyer, unsigned char value, simTime start, simTime bitTime, bool framingError)
+{
+    unsigned char line = fromKeyer ? sigUartTx : sigUartRx;
+    unsigned char bitPos;
+    
+    // Start bit, 8 data bits (LSB first) and the stop bit.
+    change(fromKeyer ? sigTxData : sigRxData, value, start);
+    change(line, 0, start);
+    
+    for(bitPos = 0; bitPos < 8; bitPos++)
+    {
+        change(line, (value >> bitPos) & 0x01, start + ((bitPos + 1) * bitTime));
+    }
+    
+    change(line, 1, start + (9 * bitTime));
+    
+    if(!fromKeyer)
+    {
+        change(sigRxError, framingError ? 1 : 0, start + (9 * bitTime));
+    }
+    
+    flush(sim.now);
+}
+
+void VcdTrace::firmwareStep(unsigned char context, const FirmwareProbe &probe)
+{
+    if(context == CONTEXT_ISR)
+    {
+        changeNow(sigInterrupts, ++interruptCount);
+    }
+    else
+    {
+        changeNow(sigTasks, ++taskCount);
+    }
+    
+    changeNow(sigContext, context);
+    changeNow(sigQueueDepth, probe.queueDepth);
+    changeNow(sigMorseElements, probe.morseElements);
+    changeNow(sigKeyState, probe.keyState);
+    changeNow(sigLastQueued, probe.lastQueued);
+    changeNow(sigTxPattern, probe.txPattern);
+    changeNow(sigTxKeyed, probe.txKeyed ? 1 : 0);
+    changeNow(sigPttState, probe.pttState);
+    changeNow(sigClockSlow, probe.clockMode);
+    changeNow(sigScreen, probe.uiScreen);
+    changeNow(sigTaskReady, probe.taskReady);
+    changeNow(sigSpeed, probe.speed);
+}
+
+unsigned char VcdTrace::declare(const char *scope, const char *name, unsigned char width, uint32_t initial)
+{
+    Signal signal;
+    
+    signal.scope = scope;
+    signal.name = name;
+    signal.width = width;
+    signal.value = initial;
+    
+    signals.push_back(signal);
+    return signals.size() - 1;
+}
+
+void VcdTrace::change(unsigned char signal, uint32_t value, simTime time)
+{
+    if(file == NULL)
+    {
+        return;
+    }
+    
+    pending.insert(std::make_pair(time, std::make_pair(signal, value)));
+}
+
+void VcdTrace::changeNow(unsigned char signal, uint32_t value)
+{
+    change(signal, value, sim.now);
+    flush(sim.now);
+}
+
+void VcdTrace::flush(simTime upTo)
+{
+    std::multimap<simTime, std::pair<unsigned char, uint32_t> >::iterator entry;
+    
+    while(!pending.empty())
+    {
+        entry = pending.begin();
+        
+        if(entry->first > upTo)
+        {
+            break;
+        }
+        
+        if(signals[entry->second.first].value != entry->second.second)
+        {
+            if((entry->first != lastTime) || !timeWritten)
+            {
+                fprintf(file, "#%llu\n", (unsigned long long)entry->first);
+                lastTime = entry->first;
+                timeWritten = true;
+            }
+            
+            signals[entry->second.first].value = entry->second.second;
+            writeValue(entry->second.first);
+        }
+        
+        pending.erase(entry);
+    }
+}
+
+void VcdTrace::writeValue(unsigned char signal)
+{
+    const Signal &info = signals[signal];
+    signed char bitPos;
+    
+    if(info.width == 1)
+    {
+        fprintf(file, "%u%s\n", info.value & 0x01, identifier(signal).c_str());
+        return;
+    }
+    
+    fputc('b', file);
+    
+    for(bitPos = info.width - 1; bitPos >= 0; bitPos--)
+    {
+        fputc(((info.value >> bitPos) & 0x01) ? '1' : '0', file);
+    }
+    
+    fprintf(file, " %s\n", identifier(signal).c_str());
+}
+
+std::string VcdTrace::identifier(unsigned char signal) const
+{
+    return std::string(1, (char)('!' + signal));
+}
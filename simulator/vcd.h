@@ -0,0 +1,88 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef SIM_VCD_H
+#define	SIM_VCD_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "hardware.h"
+#include "firmware.h"
+
+// Value change dump (IEEE 1364) of the modelled pins and the firmware state 
+// with the virtual time stamps. UART lines are traced at the bit level.
+class VcdTrace : public SimObserver
+{
+public:
+    VcdTrace();
+    ~VcdTrace();
+    
+    bool open(const char *fileName);
+    void close();
+    
+    void portChanged(char port, unsigned char value) override;
+    void toneChanged(bool active, unsigned char duty, unsigned long frequency) override;
+    void uartByte(bool fromKeyer, unsigned char value, simTime start, simTime bitTime, bool framingError) override;
+    void firmwareStep(unsigned char context, const FirmwareProbe &probe) override;
+    
+private:
+    struct Signal
+    {
+        std::string scope;
+        std::string name;
+        unsigned char width;
+        uint32_t value;
+    };
+    
+    unsigned char declare(const char *scope, const char *name, unsigned char width, uint32_t initial);
+    void change(unsigned char signal, uint32_t value, simTime time);
+    void changeNow(unsigned char signal, uint32_t value);
+    void flush(simTime upTo);
+    void writeValue(unsigned char signal);
+    std::string identifier(unsigned char signal) const;
+    
+    FILE *file;
+    std::vector<Signal> signals;
+    std::multimap<simTime, std::pair<unsigned char, uint32_t> > pending;
+    simTime lastTime;
+    bool timeWritten;
+    
+    uint32_t interruptCount;
+    uint32_t taskCount;
+    
+    // Signal indexes.
+    unsigned char sigKey, sigDah, sigEncoderA, sigEncoderB, sigEncoderSwitch, sigPttSwitch, sigMemSwitch;
+    unsigned char sigPtt, sigMute, sigBacklight;
+    unsigned char sigLcdE, sigLcdRs, sigLcdData;
+    unsigned char sigTone, sigToneDuty, sigToneFrequency;
+    unsigned char sigUartRx, sigUartTx, sigRxData, sigTxData, sigRxError;
+    unsigned char sigQueueDepth, sigMorseElements, sigKeyState, sigTxPattern, sigTxKeyed, sigPttState;
+    unsigned char sigClockSlow, sigScreen, sigTaskReady, sigLastQueued, sigSpeed, sigInterrupts, sigTasks, sigContext;
+};
+
+#endif	/* SIM_VCD_H */
@@ -0,0 +1,95 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+// Register model of the PIC16F886 used by the host build of the firmware. It 
+// replaces the XC8 device header, so every SFR access of the firmware is routed 
+// through the simulator.
+
+#ifndef SIM_XC_H
+#define	SIM_XC_H
+
+#ifndef __cplusplus
+#error Host build of the firmware must be compiled as C++.
+#endif
+
+// Special function register. Peripherals are notified on every write and some 
+// registers (PORTB, RCREG, TMR0, TMR1) are evaluated on read.
+class Register
+{
+public:
+    Register(const char *name, unsigned char resetValue, unsigned char readOnlyMask = 0);
+    
+    operator unsigned char() const;
+    Register &operator=(unsigned char newValue);
+    Register &operator|=(unsigned char mask);
+    Register &operator&=(unsigned char mask);
+    Register &operator^=(unsigned char mask);
+    
+    Register(const Register &) = delete;
+    Register &operator=(const Register &) = delete;
+    
+    const char *name;
+    unsigned char value;
+    unsigned char readOnly;
+};
+
+// Single bit of a special function register (XC8 bit names like RCIF).
+class RegisterBit
+{
+public:
+    RegisterBit(Register &owner, unsigned char bitMask);
+    
+    operator unsigned char() const;
+    RegisterBit &operator=(unsigned char state);
+    
+    RegisterBit(const RegisterBit &) = delete;
+    RegisterBit &operator=(const RegisterBit &) = delete;
+    
+    Register &reg;
+    unsigned char mask;
+};
+
+extern Register PORTA, PORTB, PORTC, TRISA, TRISB, TRISC, WPUB;
+extern Register INTCON, PIE1, PIR1, OPTION_REG, OSCCON;
+extern Register TMR0, TMR1L, TMR1H, T1CON, TMR2, T2CON, PR2, CCPR1L, CCP1CON;
+extern Register RCSTA, TXSTA, RCREG, TXREG, SPBRG, SPBRGH, BAUDCTL;
+extern Register ANSEL, ANSELH, ADCON0, CM1CON0, CM2CON0, SSPCON, EECON1;
+
+extern RegisterBit GIE, PEIE, T0IE, T0IF;
+extern RegisterBit TMR1IF, TMR2IF, TXIF, RCIF, TMR1IE, TMR2IE, TXIE, RCIE;
+extern RegisterBit RB0, RB1, RB2, RB3, RB4, RB5, RB6, RB7;
+extern RegisterBit TRMT, RCIDL, CREN, OERR, FERR, WR;
+
+// Busy wait and instruction timing in the instruction cycles of the running clock.
+void simDelayCycles(unsigned long long cycles);
+
+#define __delay_us(x)   simDelayCycles((unsigned long long)(x) * (_XTAL_FREQ / 4000000UL))
+#define __delay_ms(x)   simDelayCycles((unsigned long long)(x) * (_XTAL_FREQ / 4000UL))
+#define NOP()           simDelayCycles(1)
+#define CLRWDT()        simDelayCycles(1)
+
+#define __interrupt(...)
+
+unsigned char eeprom_read(unsigned char addr);
+void eeprom_write(unsigned char addr, unsigned char value);
+
+#endif	/* SIM_XC_H */
@@ -0,0 +1,771 @@
+/******************************************************************************
+ * Copyright (C) 2019 Dilshan R Jayakody.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS 
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+// Linux host tool of the keyer. Streams text with the XON / XOFF flow control of 
+// the keyer, transfers the memory slots and reports the keying throughput.
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#define DEFAULT_BAUD        38400
+#define DEFAULT_IDLE_TIME   10.0    // Seconds without an echo before the stream is closed.
+#define REPLY_TIME          2000    // Milliseconds to wait for a reply of the keyer.
+
+#define FLOW_XON            0x11
+#define FLOW_XOFF           0x13
+
+#define CTRL_DIAG           0x05
+#define CTRL_SLOT_READ      0x07
+#define CTRL_SLOT_WRITE     0x17
+#define CTRL_TRACE          0x18
+
+#define SLOT_COUNT          6
+#define SLOT_SIZE           31
+#define FIST_MARKER         0x01
+
+// Event trace dump: marker, ticks (10ms) since the newest entry, entry count and 
+// the entries. Entries hold the ticks since the previous entry, and TRACE_GAP 
+// marks a gap of 2.55 seconds or longer.
+#define TRACE_MARKER        0xFE
+#define TRACE_TICK          0.01
+#define TRACE_GAP           0xFF
+#define TRACE_EMPTY         0x3F
+
+static int port = -1;
+static bool flowPaused = false;
+
+// Memory slot write request of the command line.
+struct SlotText
+{
+    int slot;
+    std::string text;
+};
+
+static void printUsage(const char *name)
+{
+    fprintf(stderr, 
+        "Usage: %s -d device [options] [file | -]\n"
+        "  -d device      Serial port of the keyer or the simulator pseudo-terminal.\n"
+        "  -b baud        Baud rate (1200, 9600, 38400, 57600 or 115200, default %d).\n"
+        "  -g slot        Print the content of the memory slot (1 - 6).\n"
+        "  -p slot=text   Write the text into the memory slot.\n"
+        "  -x             Memory slot content is in hex digits.\n"
+        "  -T             Print the event trace of the keyer.\n"
+        "  -S wpm         Configured speed for the statistics (default asks the keyer).\n"
+        "  -t seconds     Time to wait for the echo after the last character (default %.0f).\n"
+        "  -q             Do not print the echoed characters.\n"
+        "Text of the file (or the standard input) is streamed if it is given, or if\n"
+        "there is no memory slot or trace option.\n", name, DEFAULT_BAUD, DEFAULT_IDLE_TIME);
+}
+
+static double monotonicTime()
+{
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+static bool openPort(const char *name, unsigned long baud)
+{
+    struct termios settings;
+    speed_t speed;
+    
+    switch(baud)
+    {
+        case 1200:
+            speed = B1200;
+            break;
+        case 9600:
+            speed = B9600;
+            break;
+        case 38400:
+            speed = B38400;
+            break;
+        case 57600:
+            speed = B57600;
+            break;
+        case 115200:
+            speed = B115200;
+            break;
+        default:
+            fprintf(stderr, "Unsupported baud rate: %lu\n", baud);
+            return false;
+    }
+    
+    port = open(name, O_RDWR | O_NOCTTY);
+    if(port < 0)
+    {
+        perror(name);
+        return false;
+    }
+    
+    // Raw 8N1 link. Flow control bytes are handled here, not by the driver.
+    if(tcgetattr(port, &settings) == 0)
+    {
+        cfmakeraw(&settings);
+        cfsetispeed(&settings, speed);
+        cfsetospeed(&settings, speed);
+        settings.c_cflag |= CLOCAL | CREAD;
+        settings.c_iflag &= ~(IXON | IXOFF | IXANY);
+        settings.c_cc[VMIN] = 0;
+        settings.c_cc[VTIME] = 0;
+        tcsetattr(port, TCSANOW, &settings);
+        tcflush(port, TCIOFLUSH);
+    }
+    
+    return true;
+}
+
+static bool writeBytes(const std::string &data)
+{
+    size_t sendPos = 0;
+    ssize_t length;
+    
+    while(sendPos < data.size())
+    {
+        length = write(port, data.data() + sendPos, data.size() - sendPos);
+        if(length < 0)
+        {
+            perror("write");
+            return false;
+        }
+        
+        sendPos += length;
+    }
+    
+    return true;
+}
+
+// Next byte from the keyer or -1 on timeout. XON and XOFF only update the flow 
+// state, except in the binary data.
+static int readByte(int timeout, bool binary = false)
+{
+    double endTime = monotonicTime() + (timeout / 1000.0);
+    struct pollfd portPoll = {port, POLLIN, 0};
+    unsigned char value;
+    int waitTime;
+    
+    while(true)
+    {
+        waitTime = (int)((endTime - monotonicTime()) * 1000);
+        if(poll(&portPoll, 1, (waitTime > 0) ? waitTime : 0) <= 0)
+        {
+            return -1;
+        }
+        
+        if(read(port, &value, 1) != 1)
+        {
+            return -1;
+        }
+        
+        if(!binary && ((value == FLOW_XON) || (value == FLOW_XOFF)))
+        {
+            flowPaused = (value == FLOW_XOFF);
+            continue;
+        }
+        
+        return value;
+    }
+}
+
+// Reply line of the keyer without the CR LF.
+static bool readLine(std::string &line, int timeout)
+{
+    int value;
+    
+    line.clear();
+    
+    while((value = readByte(timeout)) >= 0)
+    {
+        if(value == '\n')
+        {
+            return true;
+        }
+        
+        if(value != '\r')
+        {
+            line += (char)value;
+        }
+    }
+    
+    return false;
+}
+
+// Keying speed from the diagnostics report of the keyer, or zero if it's not reported.
+static unsigned int readSpeed()
+{
+    std::string line;
+    size_t speedPos;
+    
+    if(!writeBytes(std::string(1, CTRL_DIAG)) || !readLine(line, REPLY_TIME))
+    {
+        return 0;
+    }
+    
+    speedPos = line.find("WPM=");
+    return (speedPos == std::string::npos) ? 0 : strtoul(line.c_str() + speedPos + 4, NULL, 10);
+}
+
+static std::string encodeHex(const std::string &data)
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
+    std::string result;
+    
+    for(unsigned char value : data)
+    {
+        result += hexDigits[value >> 4];
+        result += hexDigits[value & 0x0F];
+    }
+    
+    return result;
+}
+
+static bool decodeHex(const std::string &text, std::string &data)
+{
+    char digits[3] = {0, 0, 0};
+    char *endPos;
+    size_t textPos;
+    
+    data.clear();
+    
+    if(text.size() & 1)
+    {
+        return false;
+    }
+    
+    for(textPos = 0; textPos < text.size(); textPos += 2)
+    {
+        digits[0] = text[textPos];
+        digits[1] = text[textPos + 1];
+        data += (char)strtoul(digits, &endPos, 16);
+        
+        if(endPos != (digits + 2))
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+static bool readSlot(int slot, std::string &data)
+{
+    std::string line;
+    
+    if(!writeBytes(std::string(1, CTRL_SLOT_READ) + (char)('0' + slot)))
+    {
+        return false;
+    }
+    
+    if(!readLine(line, REPLY_TIME) || !decodeHex(line, data))
+    {
+        fprintf(stderr, "Memory slot %d: no valid reply from the keyer\n", slot);
+        return false;
+    }
+    
+    return true;
+}
+
+static bool writeSlot(int slot, const std::string &data)
+{
+    std::string line;
+    int value;
+    
+    if(!writeBytes(std::string(1, CTRL_SLOT_WRITE) + (char)('0' + slot)))
+    {
+        return false;
+    }
+    
+    // Keyer prompts for the data once the message buffer is available.
+    do
+    {
+        value = readByte(REPLY_TIME);
+    }
+    while((value >= 0) && (value != '>') && (value != '?'));
+    
+    if(value != '>')
+    {
+        readLine(line, REPLY_TIME);
+        fprintf(stderr, "Memory slot %d: keyer is busy, close the menus and try again\n", slot);
+        return false;
+    }
+    
+    if(!writeBytes(encodeHex(data) + '\r') || !readLine(line, REPLY_TIME) || (line != "OK"))
+    {
+        fprintf(stderr, "Memory slot %d: write failed\n", slot);
+        return false;
+    }
+    
+    return true;
+}
+
+static void printSlot(int slot, const std::string &data, bool hexMode)
+{
+    if(hexMode)
+    {
+        printf("%d: %s\n", slot, encodeHex(data).c_str());
+    }
+    else if(!data.empty() && (data[0] == FIST_MARKER))
+    {
+        printf("%d: <fist recording, %u elements>\n", slot, (unsigned int)(data.size() - 1));
+    }
+    else
+    {
+        printf("%d: %s\n", slot, data.c_str());
+    }
+}
+
+// Message text is stored in upper case. Macro tokens are expanded while the 
+// message is played.
+static bool checkSlotText(std::string &text)
+{
+    for(char &value : text)
+    {
+        if((value >= 'a') && (value <= 'z'))
+        {
+            value -= 32;
+        }
+        
+        if(!(((value >= 'A') && (value <= 'Z')) || ((value >= '0') && (value <= '9')) || (strchr(" #<>%@", value) != NULL)))
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// Event trace of the keyer, oldest event first. Time is relative to the dump, 
+// and times before a long gap are upper bounds (shown with '<').
+static bool printTrace()
+{
+    static const char *modeNames[] = {"host", "keyer", "dual", "?"};
+    static const char *stateNames[] = {"key up", "key down", "dot", "dash", "Morse buffer full"};
+    static const char *charEvents[] = {"decode", "push", "drop"};
+    unsigned char header[3];
+    std::vector<unsigned char> entries;
+    std::vector<double> entryTimes;
+    std::vector<bool> entryBounds;
+    unsigned char eventType, eventData;
+    int value;
+    unsigned int entryPos;
+    double eventTime;
+    bool isBound;
+    
+    if(!writeBytes(std::string(1, CTRL_TRACE)))
+    {
+        return false;
+    }
+    
+    // Echoed characters may precede the dump.
+    do
+    {
+        value = readByte(REPLY_TIME, true);
+    }
+    while((value >= 0) && (value != TRACE_MARKER));
+    
+    header[0] = value;
+    for(entryPos = 1; (entryPos < 3) && (value >= 0); entryPos++)
+    {
+        header[entryPos] = value = readByte(REPLY_TIME, true);
+    }
+    
+    if(value < 0)
+    {
+        fprintf(stderr, "Event trace: no valid reply from the keyer\n");
+        return false;
+    }
+    
+    for(entryPos = 0; entryPos < (2U * header[2]); entryPos++)
+    {
+        if((value = readByte(REPLY_TIME, true)) < 0)
+        {
+            fprintf(stderr, "Event trace: dump is incomplete\n");
+            return false;
+        }
+        
+        entries.push_back((unsigned char)value);
+    }
+    
+    // Walk back from the newest entry and accumulate the elapsed times.
+    entryTimes.resize(header[2]);
+    entryBounds.resize(header[2]);
+    eventTime = -header[1] * TRACE_TICK;
+    isBound = (header[1] == TRACE_GAP);
+    
+    for(entryPos = header[2]; entryPos > 0; entryPos--)
+    {
+        entryTimes[entryPos - 1] = eventTime;
+        entryBounds[entryPos - 1] = isBound;
+        eventTime -= entries[2 * (entryPos - 1)] * TRACE_TICK;
+        isBound = isBound || (entries[2 * (entryPos - 1)] == TRACE_GAP);
+    }
+    
+    for(entryPos = 0; entryPos < header[2]; entryPos++)
+    {
+        eventType = entries[(2 * entryPos) + 1] >> 6;
+        eventData = entries[(2 * entryPos) + 1] & 0x3F;
+        
+        if((eventType == 0) && (eventData == TRACE_EMPTY))
+        {
+            continue;
+        }
+        
+        printf("%c%7.2f  ", entryBounds[entryPos] ? '<' : ' ', entryTimes[entryPos]);
+        
+        if(eventType != 0)
+        {
+            printf("%s '%c'\n", charEvents[eventType - 1], eventData + 32);
+        }
+        else if(eventData >= 0x08)
+        {
+            printf("mode %s\n", modeNames[eventData & 0x03]);
+        }
+        else if(eventData < 5)
+        {
+            printf("%s\n", stateNames[eventData]);
+        }
+        else
+        {
+            printf("event 0x%02X\n", eventData);
+        }
+    }
+    
+    return true;
+}
+
+// Text accepted by the keyer: letters, digits and spaces.
+static std::string filterText(const std::string &text, unsigned int &dropped)
+{
+    std::string result;
+    
+    dropped = 0;
+    
+    for(char value : text)
+    {
+        if((value >= 'a') && (value <= 'z'))
+        {
+            value -= 32;
+        }
+        
+        if((value == '\r') || (value == '\n') || (value == '\t'))
+        {
+            value = ' ';
+        }
+        
+        if(((value >= 'A') && (value <= 'Z')) || ((value >= '0') && (value <= '9')) || (value == ' '))
+        {
+            result += value;
+        }
+        else
+        {
+            dropped++;
+        }
+    }
+    
+    return result;
+}
+
+// Stream the text while the keyer allows and count the characters echoed by the 
+// keyer as they are sent.
+static bool streamText(const std::string &text, double idleTime, bool quiet, unsigned int configuredWpm)
+{
+    struct pollfd portPoll = {port, POLLIN, 0};
+    size_t sendPos = 0, echoCount = 0;
+    double firstEcho = 0, lastEcho = monotonicTime();
+    double elapsed, charsPerMinute;
+    unsigned char value;
+    
+    while(echoCount < text.size())
+    {
+        portPoll.events = (!flowPaused && (sendPos < text.size())) ? (POLLIN | POLLOUT) : POLLIN;
+        
+        if(poll(&portPoll, 1, 100) < 0)
+        {
+            perror("poll");
+            return false;
+        }
+        
+        // One byte per write keeps the send position close to the XOFF point.
+        if((portPoll.revents & POLLOUT) && !flowPaused && (sendPos < text.size()))
+        {
+            if(write(port, &text[sendPos], 1) == 1)
+            {
+                sendPos++;
+            }
+        }
+        
+        if((portPoll.revents & POLLIN) && (read(port, &value, 1) == 1))
+        {
+            if((value == FLOW_XON) || (value == FLOW_XOFF))
+            {
+                flowPaused = (value == FLOW_XOFF);
+            }
+            else if((value >= ' ') && (value < 0x7F))
+            {
+                lastEcho = monotonicTime();
+                if(echoCount == 0)
+                {
+                    firstEcho = lastEcho;
+                }
+                
+                echoCount++;
+                
+                if(!quiet)
+                {
+                    putchar(value);
+                    fflush(stdout);
+                }
+            }
+        }
+        
+        if((portPoll.revents & (POLLERR | POLLHUP)) != 0)
+        {
+            fprintf(stderr, "Serial port is closed\n");
+            return false;
+        }
+        
+        if((monotonicTime() - lastEcho) > idleTime)
+        {
+            fprintf(stderr, "\nNo echo from the keyer for %.0f seconds\n", idleTime);
+            break;
+        }
+    }
+    
+    if(!quiet)
+    {
+        putchar('\n');
+        fflush(stdout);
+    }
+    
+    // Characters are echoed as they are started, so the first one has no length.
+    elapsed = lastEcho - firstEcho;
+    charsPerMinute = ((echoCount > 1) && (elapsed > 0)) ? ((echoCount - 1) * 60.0) / elapsed : 0;
+    
+    fprintf(stderr, "Sent %u of %u characters in %.1f seconds: %.1f CPM (%.1f WPM)", (unsigned int)echoCount, 
+        (unsigned int)text.size(), elapsed, charsPerMinute, charsPerMinute / 5);
+    
+    if(configuredWpm > 0)
+    {
+        fprintf(stderr, ", configured %u WPM (%u CPM)", configuredWpm, configuredWpm * 5);
+    }
+    
+    fprintf(stderr, "\n");
+    return echoCount == text.size();
+}
+
+static bool loadFile(const char *fileName, std::string &content)
+{
+    FILE *file = (strcmp(fileName, "-") == 0) ? stdin : fopen(fileName, "rb");
+    char buffer[512];
+    size_t length;
+    
+    if(file == NULL)
+    {
+        perror(fileName);
+        return false;
+    }
+    
+    while((length = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        content.append(buffer, length);
+    }
+    
+    if(file != stdin)
+    {
+        fclose(file);
+    }
+    
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *deviceName = NULL;
+    const char *fileName = NULL;
+    unsigned long baud = DEFAULT_BAUD;
+    unsigned int configuredWpm = 0, dropped;
+    double idleTime = DEFAULT_IDLE_TIME;
+    bool hexMode = false, quiet = false, traceDump = false, result = true;
+    std::vector<int> readSlots;
+    std::vector<SlotText> writeSlots;
+    SlotText slotText;
+    std::string text, data;
+    int option;
+    
+    while((option = getopt(argc, argv, "d:b:g:p:xTS:t:qh")) != -1)
+    {
+        switch(option)
+        {
+            case 'd':
+                deviceName = optarg;
+                break;
+            case 'b':
+                baud = strtoul(optarg, NULL, 10);
+                break;
+            case 'g':
+                readSlots.push_back(atoi(optarg));
+                break;
+            case 'p':
+                slotText.slot = atoi(optarg);
+                slotText.text = (strchr(optarg, '=') != NULL) ? (strchr(optarg, '=') + 1) : "";
+                writeSlots.push_back(slotText);
+                break;
+            case 'x':
+                hexMode = true;
+                break;
+            case 'T':
+                traceDump = true;
+                break;
+            case 'S':
+                configuredWpm = strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                idleTime = atof(optarg);
+                break;
+            case 'q':
+                quiet = true;
+                break;
+            default:
+                printUsage(argv[0]);
+                return (option == 'h') ? 0 : 1;
+        }
+    }
+    
+    if((deviceName == NULL) || ((argc - optind) > 1))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    if(optind < argc)
+    {
+        fileName = argv[optind];
+    }
+    else if(readSlots.empty() && writeSlots.empty() && !traceDump)
+    {
+        fileName = "-";
+    }
+    
+    for(int slot : readSlots)
+    {
+        if((slot < 1) || (slot > SLOT_COUNT))
+        {
+            fprintf(stderr, "Invalid memory slot: %d\n", slot);
+            return 1;
+        }
+    }
+    
+    // Slot text is checked before the port is opened.
+    for(SlotText &slotEntry : writeSlots)
+    {
+        if((slotEntry.slot < 1) || (slotEntry.slot > SLOT_COUNT))
+        {
+            fprintf(stderr, "Invalid memory slot: %d\n", slotEntry.slot);
+            return 1;
+        }
+        
+        if(hexMode)
+        {
+            if(!decodeHex(slotEntry.text, data))
+            {
+                fprintf(stderr, "Memory slot %d: invalid hex data\n", slotEntry.slot);
+                return 1;
+            }
+            
+            slotEntry.text = data;
+        }
+        else if(!checkSlotText(slotEntry.text))
+        {
+            fprintf(stderr, "Memory slot %d: only letters, digits, spaces and macro tokens are allowed\n", slotEntry.slot);
+            return 1;
+        }
+        
+        if(slotEntry.text.size() > SLOT_SIZE)
+        {
+            fprintf(stderr, "Memory slot %d: message is longer than %d characters\n", slotEntry.slot, SLOT_SIZE);
+            return 1;
+        }
+    }
+    
+    if((fileName != NULL) && !loadFile(fileName, text))
+    {
+        return 1;
+    }
+    
+    if(!openPort(deviceName, baud))
+    {
+        return 1;
+    }
+    
+    for(SlotText &slotEntry : writeSlots)
+    {
+        result = writeSlot(slotEntry.slot, slotEntry.text) && result;
+    }
+    
+    for(int slot : readSlots)
+    {
+        if(readSlot(slot, data))
+        {
+            printSlot(slot, data, hexMode);
+        }
+        else
+        {
+            result = false;
+        }
+    }
+    
+    if(traceDump)
+    {
+        result = printTrace() && result;
+    }
+    
+    if(fileName != NULL)
+    {
+        text = filterText(text, dropped);
+        
+        if(dropped > 0)
+        {
+            fprintf(stderr, "%u characters without a Morse code are not sent\n", dropped);
+        }
+        
+        if(configuredWpm == 0)
+        {
+            configuredWpm = readSpeed();
+        }
+        
+        result = streamText(text, idleTime, quiet, configuredWpm) && result;
+    }
+    
+    close(port);
+    return result ? 0 : 1;
+}